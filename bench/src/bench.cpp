@@ -0,0 +1,170 @@
+#include <math.h>
+#include <chrono>
+
+#include "bench.h"
+#include "array.h"
+#include "fmt.h"
+#include "sort.h"
+
+namespace zw::bench {
+
+const void* volatile impl::escape_sink;
+
+// Fewest timed samples a benchmark takes, even if they don't fit in Options::max_run_ns
+constexpr uint32_t MIN_SAMPLES = 3;
+
+static uint64_t time_sample(void (*body)(void* context, uint64_t iterations), void* context, uint64_t iterations) {
+    auto start = std::chrono::steady_clock::now();
+    body(context, iterations);
+    auto end = std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+// Nearest-rank percentile of sorted samples
+static double percentile(const Array<double>& sorted, uint32_t p) {
+    size_t rank = (sorted.size() * p + 99) / 100;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+// Two decimal places are plenty for nanoseconds, and keep the output readable
+static double rounded(double value) {
+    return round(value * 100.0) / 100.0;
+}
+
+static void print_padding(size_t size, size_t width) {
+    for(size_t i = size; i < width; i++) {
+        zw_print(" ");
+    }
+}
+
+Runner::Runner(const Options& options) : _options(options), _num_results(0) {
+    if(_options.is_listing) return;
+    switch(_options.format) {
+        case OutputFormat::TEXT:
+            break;
+        case OutputFormat::JSON:
+            zw_println("{{");
+            zw_println("  \"warmup_samples\": {},", _options.warmup_samples);
+            zw_println("  \"samples\": {},", _options.samples);
+            zw_println("  \"min_sample_ns\": {},", _options.min_sample_ns);
+            zw_println("  \"max_run_ns\": {},", _options.max_run_ns);
+#ifdef NDEBUG
+            zw_println("  \"assertions\": false,");
+#else
+            zw_println("  \"assertions\": true,");
+#endif
+            zw_print("  \"benchmarks\": [");
+            break;
+        case OutputFormat::CSV:
+            zw_println("name,iterations,samples,min_ns,p50_ns,p90_ns,p99_ns,max_ns,mean_ns,bytes_per_second");
+            break;
+    }
+}
+
+Runner::~Runner() {
+    if(_options.is_listing) return;
+    if(_options.format == OutputFormat::JSON) {
+        if(_num_results) {
+            zw_println("");
+            zw_println("  ]");
+        } else {
+            zw_println("]");
+        }
+        zw_println("}}");
+    }
+    zw_get_ctx(printer)->sync();
+}
+
+void Runner::run_body(StringSlice name, uint64_t bytes_per_iteration, Body body, void* context) {
+    if(!name.contains(_options.filter)) return;
+    if(_options.is_listing) {
+        zw_println("{}", name);
+        return;
+    }
+
+    // Find an iteration count that makes a sample long enough for the clock's resolution and the per-sample
+    // overhead not to matter
+    uint64_t iterations = 1;
+    uint64_t sample_ns;
+    for(;;) {
+        uint64_t ns = time_sample(body, context, iterations);
+        sample_ns = ns;
+        if(ns >= _options.min_sample_ns) break;
+        // Aim a little past the target, but grow at most tenfold at a time in case the first samples were
+        // unrepresentative, e.g. because of cold caches
+        uint64_t next = ns ? (uint64_t)((double)iterations * 1.4 * (double)_options.min_sample_ns / (double)ns) : iterations * 10;
+        if(next > iterations * 10) next = iterations * 10;
+        if(next <= iterations) next = iterations + 1;
+        iterations = next;
+    }
+
+    // Benchmarks with long samples, like building big containers, take fewer of them. The last calibration
+    // sample then stands in for the warmup.
+    uint32_t num_warmup_samples = _options.warmup_samples;
+    uint32_t num_samples = _options.samples;
+    uint64_t samples_in_budget = sample_ns ? _options.max_run_ns / sample_ns : UINT64_MAX;
+    if(num_warmup_samples + num_samples > samples_in_budget) {
+        num_warmup_samples = 0;
+        if(num_samples > samples_in_budget) {
+            num_samples = samples_in_budget < MIN_SAMPLES ? MIN_SAMPLES : (uint32_t)samples_in_budget;
+        }
+    }
+
+    for(uint32_t i = 0; i < num_warmup_samples; i++) {
+        time_sample(body, context, iterations);
+    }
+
+    Array<double> samples;
+    samples.reserve(num_samples);
+    double total = 0;
+    for(uint32_t i = 0; i < num_samples; i++) {
+        double ns_per_iteration = (double)time_sample(body, context, iterations) / (double)iterations;
+        samples.push(ns_per_iteration);
+        total += ns_per_iteration;
+    }
+    sort(samples.data(), samples.size());
+
+    double min = rounded(samples[0]);
+    double p50 = rounded(percentile(samples, 50));
+    double p90 = rounded(percentile(samples, 90));
+    double p99 = rounded(percentile(samples, 99));
+    double max = rounded(samples.last());
+    double mean = rounded(total / (double)samples.size());
+    double bytes_per_second = bytes_per_iteration ? round((double)bytes_per_iteration * 1e9 / percentile(samples, 50)) : 0;
+
+    switch(_options.format) {
+        case OutputFormat::TEXT:
+            zw_print("{}", name);
+            print_padding(name.size(), 40);
+            zw_print(" p50 {} ns  p90 {} ns  p99 {} ns  min {} ns  max {} ns", p50, p90, p99, min, max);
+            if(bytes_per_iteration) {
+                zw_print("  {} MB/s", round(bytes_per_second / 1e6));
+            }
+            zw_println("  ({} x {} iterations)", samples.size(), iterations);
+            break;
+        case OutputFormat::JSON:
+            if(_num_results) {
+                zw_print(",");
+            }
+            zw_println("");
+            zw_print("    {{\"name\": \"{}\", \"iterations\": {}, \"samples\": {}, ", name, iterations, samples.size());
+            zw_print("\"min_ns\": {}, \"p50_ns\": {}, \"p90_ns\": {}, \"p99_ns\": {}, \"max_ns\": {}, \"mean_ns\": {}", min, p50, p90, p99, max, mean);
+            if(bytes_per_iteration) {
+                zw_print(", \"bytes_per_second\": {}", bytes_per_second);
+            }
+            zw_print("}}");
+            break;
+        case OutputFormat::CSV:
+            zw_print("{},{},{},{},{},{},{},{},{},", name, iterations, samples.size(), min, p50, p90, p99, max, mean);
+            if(bytes_per_iteration) {
+                zw_print("{}", bytes_per_second);
+            }
+            zw_println("");
+            break;
+    }
+    // Keep results coming while the suite runs, even when stdout is a pipe
+    zw_get_ctx(printer)->sync();
+    _num_results++;
+}
+
+};
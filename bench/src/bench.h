@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#include "string.h"
+
+// A small microbenchmark harness. Each benchmark is a function that runs the operation being measured a given
+// number of times. The runner first finds an iteration count that makes one sample take at least
+// Options::min_sample_ns, then runs some warmup samples that are thrown away, then times Options::samples
+// samples and reports percentiles of the time per iteration across them. Percentiles rather than a single
+// average keep one-off interruptions from skewing the result, and make noisy benchmarks visible as a wide
+// spread between p50 and p99.
+
+namespace zw::bench {
+
+namespace impl {
+    extern const void* volatile escape_sink;
+};
+
+/// Makes the compiler assume that value is read, so that computing it can't be optimized away.
+template<typename T>
+void do_not_optimize(const T& value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    impl::escape_sink = &value;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r"(&value) : "memory");
+#endif
+}
+
+/// Makes the compiler assume that all memory is read and written.
+inline void clobber_memory() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : : "memory");
+#endif
+}
+
+/// SplitMix64, for reproducible benchmark inputs.
+inline uint64_t random_u64(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+enum class OutputFormat {
+    TEXT,
+    JSON,
+    CSV,
+};
+
+struct Options {
+    /// Only benchmarks whose names contain this are run.
+    StringSlice filter;
+    OutputFormat format = OutputFormat::TEXT;
+    /// Just print the names of the benchmarks that would run.
+    bool is_listing = false;
+    uint32_t warmup_samples = 5;
+    uint32_t samples = 51;
+    uint64_t min_sample_ns = 2000000;
+    /// Benchmarks whose samples take long take fewer samples than asked for, to fit in about this long.
+    uint64_t max_run_ns = 10000000000;
+    /// Largest number of entries the hash map benchmarks fill maps with.
+    uint64_t max_map_size = 10000000;
+};
+
+class Runner {
+    using Body = void (*)(void* context, uint64_t iterations);
+
+    Options _options;
+    uint32_t _num_results;
+
+    void run_body(StringSlice name, uint64_t bytes_per_iteration, Body body, void* context);
+
+public:
+    /// Prints the header of the output format.
+    explicit Runner(const Options& options);
+    Runner(const Runner& other) = delete;
+    Runner(Runner&& other) = delete;
+    /// Prints the footer of the output format.
+    ~Runner();
+
+    /// Measures body(iterations), which must run what's being measured that many times. Setup that can't be
+    /// hoisted out of body should be amortized over enough work per iteration to not matter. If
+    /// bytes_per_iteration is given, throughput is reported as well.
+    template<typename F>
+    void run(StringSlice name, F body, uint64_t bytes_per_iteration = 0) {
+        run_body(name, bytes_per_iteration, [](void* context, uint64_t iterations) { (*(F*)context)(iterations); }, &body);
+    }
+
+    /// Whether run(name, ...) would time anything, for skipping expensive setup otherwise.
+    bool is_timing(StringSlice name) const { return !_options.is_listing && name.contains(_options.filter); }
+    const Options& options() const { return _options; }
+};
+
+// Each group of benchmarks, registered in main.cpp
+void bench_alloc(Runner& runner);
+void bench_array(Runner& runner);
+void bench_string(Runner& runner);
+void bench_fmt(Runner& runner);
+void bench_context(Runner& runner);
+void bench_hash_map(Runner& runner);
+void bench_hash(Runner& runner);
+void bench_queue(Runner& runner);
+void bench_iter(Runner& runner);
+void bench_option(Runner& runner);
+void bench_trace(Runner& runner);
+void bench_sort(Runner& runner);
+void bench_parse(Runner& runner);
+
+};
@@ -0,0 +1,101 @@
+#include <stdlib.h>
+
+#include "bench.h"
+#include "alloc.h"
+#include "fmt.h"
+
+namespace zw::bench {
+
+constexpr size_t BATCH_SIZE = 16;
+constexpr size_t ALIGNMENT = 16;
+constexpr size_t ARENA_BLOCK_SIZE = 256;
+
+struct AllocatorCase {
+    const char* name;
+    Allocator* allocator;
+    // Bump allocators don't reuse freed memory, so in batches they're reset after each one, as they would be
+    // after each frame or request. Otherwise they're only reset when they run out.
+    bool is_bump;
+};
+
+static void* alloc_or_reset(size_t size) {
+    void* address = zw_alloc(size, ALIGNMENT);
+    if(!address) {
+        zw_alloc_reset();
+        address = zw_alloc(size, ALIGNMENT);
+    }
+    return address;
+}
+
+void bench_alloc(Runner& runner) {
+    size_t linear_size = 1024 * 1024;
+    uint8_t* linear_buffer = (uint8_t*)zw_alloc(&global_allocator, linear_size, ALIGNMENT);
+    LinearAllocator linear(linear_buffer, linear_size);
+    size_t arena_size = 64 * 1024;
+    uint8_t* arena_buffer = (uint8_t*)zw_alloc(&global_allocator, arena_size, ALIGNMENT);
+    ArenaAllocator arena(arena_buffer, arena_size, ARENA_BLOCK_SIZE, ALIGNMENT);
+
+    AllocatorCase cases[] = {
+        {"global", &global_allocator, false},
+        {"linear", &linear, true},
+        {"arena", &arena, false},
+        {"temp", zw_get_ctx(temp_allocator), true},
+    };
+
+    for(size_t size: {(size_t)16, (size_t)256}) {
+        runner.run(zw_format("alloc/single/{}/malloc", size).as_slice(), [&](uint64_t iterations) {
+            for(uint64_t i = 0; i < iterations; i++) {
+                void* address = malloc(size);
+                do_not_optimize(address);
+                free(address);
+            }
+        });
+        for(AllocatorCase& allocator_case: cases) {
+            runner.run(zw_format("alloc/single/{}/{}", size, allocator_case.name).as_slice(), [&](uint64_t iterations) {
+                // Set here rather than around run(), which allocates too
+                zw_set_ctx(allocator, allocator_case.allocator);
+                for(uint64_t i = 0; i < iterations; i++) {
+                    void* address = alloc_or_reset(size);
+                    do_not_optimize(address);
+                    zw_free(address);
+                }
+            });
+        }
+
+        runner.run(zw_format("alloc/batch_of_{}/{}/malloc", BATCH_SIZE, size).as_slice(), [&](uint64_t iterations) {
+            void* addresses[BATCH_SIZE];
+            for(uint64_t i = 0; i < iterations; i++) {
+                for(size_t j = 0; j < BATCH_SIZE; j++) {
+                    addresses[j] = malloc(size);
+                }
+                do_not_optimize(addresses);
+                for(size_t j = 0; j < BATCH_SIZE; j++) {
+                    free(addresses[j]);
+                }
+            }
+        });
+        for(AllocatorCase& allocator_case: cases) {
+            runner.run(zw_format("alloc/batch_of_{}/{}/{}", BATCH_SIZE, size, allocator_case.name).as_slice(), [&](uint64_t iterations) {
+                zw_set_ctx(allocator, allocator_case.allocator);
+                void* addresses[BATCH_SIZE];
+                for(uint64_t i = 0; i < iterations; i++) {
+                    for(size_t j = 0; j < BATCH_SIZE; j++) {
+                        addresses[j] = zw_alloc(size, ALIGNMENT);
+                    }
+                    do_not_optimize(addresses);
+                    for(size_t j = 0; j < BATCH_SIZE; j++) {
+                        zw_free(addresses[j]);
+                    }
+                    if(allocator_case.is_bump) {
+                        zw_alloc_reset();
+                    }
+                }
+            });
+        }
+    }
+
+    zw_free(&global_allocator, arena_buffer);
+    zw_free(&global_allocator, linear_buffer);
+}
+
+};
@@ -0,0 +1,108 @@
+#include <vector>
+
+#include "bench.h"
+#include "array.h"
+
+namespace zw::bench {
+
+constexpr uint32_t NUM_PUSHES = 1000;
+constexpr uint32_t NUM_INSERTS = 256;
+
+void bench_array(Runner& runner) {
+    // Growing from empty, including the reallocations
+    runner.run("array/push/1000/zw", [](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            Array<uint32_t> array;
+            for(uint32_t j = 0; j < NUM_PUSHES; j++) {
+                array.push(j);
+            }
+            do_not_optimize(array.data());
+        }
+    });
+    runner.run("array/push/1000/std", [](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            std::vector<uint32_t> vector;
+            for(uint32_t j = 0; j < NUM_PUSHES; j++) {
+                vector.push_back(j);
+            }
+            do_not_optimize(vector.data());
+        }
+    });
+
+    runner.run("array/push_reserved/1000/zw", [](uint64_t iterations) {
+        Array<uint32_t> array;
+        array.reserve(NUM_PUSHES);
+        for(uint64_t i = 0; i < iterations; i++) {
+            array.clear();
+            for(uint32_t j = 0; j < NUM_PUSHES; j++) {
+                array.push(j);
+            }
+            do_not_optimize(array.data());
+        }
+    });
+    runner.run("array/push_reserved/1000/std", [](uint64_t iterations) {
+        std::vector<uint32_t> vector;
+        vector.reserve(NUM_PUSHES);
+        for(uint64_t i = 0; i < iterations; i++) {
+            vector.clear();
+            for(uint32_t j = 0; j < NUM_PUSHES; j++) {
+                vector.push_back(j);
+            }
+            do_not_optimize(vector.data());
+        }
+    });
+
+    // Each element goes in at the front, shifting everything after it
+    runner.run("array/insert_front/256/zw", [](uint64_t iterations) {
+        Array<uint32_t> array;
+        array.reserve(NUM_INSERTS);
+        for(uint64_t i = 0; i < iterations; i++) {
+            array.clear();
+            for(uint32_t j = 0; j < NUM_INSERTS; j++) {
+                array.insert(0, j);
+            }
+            do_not_optimize(array.data());
+        }
+    });
+    runner.run("array/insert_front/256/std", [](uint64_t iterations) {
+        std::vector<uint32_t> vector;
+        vector.reserve(NUM_INSERTS);
+        for(uint64_t i = 0; i < iterations; i++) {
+            vector.clear();
+            for(uint32_t j = 0; j < NUM_INSERTS; j++) {
+                vector.insert(vector.begin(), j);
+            }
+            do_not_optimize(vector.data());
+        }
+    });
+
+    // Filling, then erasing from the front until empty
+    runner.run("array/erase_front/256/zw", [](uint64_t iterations) {
+        Array<uint32_t> array;
+        array.reserve(NUM_INSERTS);
+        for(uint64_t i = 0; i < iterations; i++) {
+            for(uint32_t j = 0; j < NUM_INSERTS; j++) {
+                array.push(j);
+            }
+            while(array.size()) {
+                array.erase(0);
+            }
+            do_not_optimize(array.data());
+        }
+    });
+    runner.run("array/erase_front/256/std", [](uint64_t iterations) {
+        std::vector<uint32_t> vector;
+        vector.reserve(NUM_INSERTS);
+        for(uint64_t i = 0; i < iterations; i++) {
+            for(uint32_t j = 0; j < NUM_INSERTS; j++) {
+                vector.push_back(j);
+            }
+            while(vector.size()) {
+                vector.erase(vector.begin());
+            }
+            do_not_optimize(vector.data());
+        }
+    });
+}
+
+};
@@ -0,0 +1,45 @@
+#include "bench.h"
+#include "alloc.h"
+#include "context.h"
+#include "fmt.h"
+
+namespace zw::bench {
+
+void bench_context(Runner& runner) {
+    runner.run("ctx/get", [](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            Allocator* allocator = zw_get_ctx(allocator);
+            do_not_optimize(allocator);
+        }
+    });
+
+    // Setting, reading back, and restoring at the end of the scope
+    runner.run("ctx/set", [](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            zw_set_ctx(indent, (uint32_t)i);
+            clobber_memory();
+            uint32_t value = zw_get_ctx(indent);
+            do_not_optimize(value);
+        }
+    });
+
+    // What most ctx reads look like in practice: the allocator being passed on to another call
+    runner.run("ctx/alloc_through_ctx", [](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            void* address = zw_alloc(16, 16);
+            do_not_optimize(address);
+            zw_free(address);
+        }
+    });
+    runner.run("ctx/alloc_explicit", [](uint64_t iterations) {
+        Allocator* allocator = zw_get_ctx(allocator);
+        for(uint64_t i = 0; i < iterations; i++) {
+            void* address = zw_alloc(allocator, 16, 16);
+            do_not_optimize(address);
+            zw_free(allocator, address);
+        }
+    });
+}
+
+};
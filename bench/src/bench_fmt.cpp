@@ -0,0 +1,87 @@
+#include <stdio.h>
+
+#include "bench.h"
+#include "fmt.h"
+
+namespace zw::bench {
+
+void bench_fmt(Runner& runner) {
+    int32_t integer = -1234567;
+    // Not exactly representable, so that it takes the full 17 digits
+    double real = 0.1 + 0.2;
+
+    runner.run("fmt/int/zw_format", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            String string = zw_format("{}", integer);
+            do_not_optimize(string);
+        }
+    });
+    runner.run("fmt/int/zw_format_to", [&](uint64_t iterations) {
+        char buffer[64];
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            zw_format_to(buffer, sizeof(buffer), "{}", integer);
+            do_not_optimize(buffer);
+        }
+    });
+    runner.run("fmt/int/snprintf", [&](uint64_t iterations) {
+        char buffer[64];
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            snprintf(buffer, sizeof(buffer), "%d", integer);
+            do_not_optimize(buffer);
+        }
+    });
+
+    // zw prints the shortest representation that round-trips; %.17g is the nearest printf equivalent
+    runner.run("fmt/double/zw_format", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            String string = zw_format("{}", real);
+            do_not_optimize(string);
+        }
+    });
+    runner.run("fmt/double/zw_format_to", [&](uint64_t iterations) {
+        char buffer[64];
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            zw_format_to(buffer, sizeof(buffer), "{}", real);
+            do_not_optimize(buffer);
+        }
+    });
+    runner.run("fmt/double/snprintf", [&](uint64_t iterations) {
+        char buffer[64];
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            snprintf(buffer, sizeof(buffer), "%.17g", real);
+            do_not_optimize(buffer);
+        }
+    });
+
+    runner.run("fmt/mixed/zw_format", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            String string = zw_format("id={} name={} value={}", integer, "widget", real);
+            do_not_optimize(string);
+        }
+    });
+    runner.run("fmt/mixed/zw_format_to", [&](uint64_t iterations) {
+        char buffer[128];
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            zw_format_to(buffer, sizeof(buffer), "id={} name={} value={}", integer, "widget", real);
+            do_not_optimize(buffer);
+        }
+    });
+    runner.run("fmt/mixed/snprintf", [&](uint64_t iterations) {
+        char buffer[128];
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            snprintf(buffer, sizeof(buffer), "id=%d name=%s value=%.17g", integer, "widget", real);
+            do_not_optimize(buffer);
+        }
+    });
+}
+
+};
@@ -0,0 +1,40 @@
+#include <functional>
+#include <string_view>
+
+#include "bench.h"
+#include "array.h"
+#include "fmt.h"
+#include "hash.h"
+
+namespace zw::bench {
+
+void bench_hash(Runner& runner) {
+    // Short keys like ids and names, and long ones like file contents
+    size_t sizes[] = {8, 12, 16, 24, 32, 64, 1024, 65536};
+    Array<char> data;
+    uint64_t state = 1;
+    for(size_t i = 0; i < 65536; i++) {
+        data.push((char)random_u64(&state));
+    }
+
+    for(size_t size: sizes) {
+        StringSlice input(data.data(), size);
+        runner.run(zw_format("hash/bytes/{}/zw", size).as_slice(), [&](uint64_t iterations) {
+            for(uint64_t i = 0; i < iterations; i++) {
+                clobber_memory();
+                uint64_t hash_value = hash(input);
+                do_not_optimize(hash_value);
+            }
+        }, size);
+        runner.run(zw_format("hash/bytes/{}/std", size).as_slice(), [&](uint64_t iterations) {
+            std::hash<std::string_view> hasher;
+            for(uint64_t i = 0; i < iterations; i++) {
+                clobber_memory();
+                size_t hash_value = hasher(std::string_view(input.data(), input.size()));
+                do_not_optimize(hash_value);
+            }
+        }, size);
+    }
+}
+
+};
@@ -0,0 +1,163 @@
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+#include "bench.h"
+#include "array.h"
+#include "fmt.h"
+#include "hash_map.h"
+
+namespace zw::bench {
+
+constexpr size_t MIN_MAP_SIZE = 1000;
+// A power of two, so that lookups can cycle through the keys with a mask
+constexpr size_t NUM_STRING_KEYS = 1024;
+
+// The maps being compared, behind the same interface. Each key maps to itself.
+struct ZwMap {
+    HashMap<uint64_t, uint64_t> map;
+
+    void insert(uint64_t key) { map.insert(key, key); }
+    uint64_t get(uint64_t key) { return *map.get(key).unwrap(); }
+    bool contains(uint64_t key) const { return map.contains(key); }
+    void remove(uint64_t key) { map.remove(key); }
+};
+
+struct StdMap {
+    std::unordered_map<uint64_t, uint64_t> map;
+
+    void insert(uint64_t key) { map.emplace(key, key); }
+    uint64_t get(uint64_t key) { return map.find(key)->second; }
+    bool contains(uint64_t key) const { return map.find(key) != map.end(); }
+    void remove(uint64_t key) { map.erase(key); }
+};
+
+// Benchmarks that run on maps already filled with keys
+static const char* const FILLED_MAP_CASES[] = {"find_hit", "find_miss", "erase_insert"};
+
+static bool is_timing_filled_map(Runner& runner, size_t size, const char* implementation) {
+    bool is_timing = false;
+    for(const char* name: FILLED_MAP_CASES) {
+        is_timing |= runner.is_timing(zw_format("hash_map/{}/{}/{}", name, size, implementation).as_slice());
+    }
+    return is_timing;
+}
+
+// Runs body(map, iterations) as hash_map/name/size/zw and hash_map/name/size/std
+template<typename F>
+static void run_both(Runner& runner, const char* name, size_t size, ZwMap* zw_map, StdMap* std_map, F body) {
+    runner.run(zw_format("hash_map/{}/{}/zw", name, size).as_slice(), [&](uint64_t iterations) { body(*zw_map, iterations); });
+    runner.run(zw_format("hash_map/{}/{}/std", name, size).as_slice(), [&](uint64_t iterations) { body(*std_map, iterations); });
+}
+
+static void bench_map_size(Runner& runner, size_t size, const Array<uint64_t>& keys, const Array<uint64_t>& missing_keys) {
+    // Looking keys up in the order they were inserted would favor std::unordered_map, whose nodes are then
+    // visited in the order they were allocated
+    Array<uint64_t> lookup_keys;
+    lookup_keys.reserve(size);
+    for(size_t i = 0; i < size; i++) {
+        lookup_keys.push(keys[i]);
+    }
+    uint64_t state = size;
+    for(size_t i = size - 1; i > 0; i--) {
+        std::swap(lookup_keys[i], lookup_keys[random_u64(&state) % (i + 1)]);
+    }
+
+    ZwMap zw_map;
+    StdMap std_map;
+
+    // One iteration builds a whole map
+    run_both(runner, "insert", size, &zw_map, &std_map, [&](auto& map, uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            std::remove_reference_t<decltype(map)> built;
+            for(size_t j = 0; j < size; j++) {
+                built.insert(keys[j]);
+            }
+            do_not_optimize(built);
+        }
+    });
+
+    if(is_timing_filled_map(runner, size, "zw") || is_timing_filled_map(runner, size, "std")) {
+        for(size_t i = 0; i < size; i++) {
+            zw_map.insert(keys[i]);
+            std_map.insert(keys[i]);
+        }
+    }
+
+    // Carries on through the keys across samples, so that samples of big maps don't keep hitting the same
+    // cached part of them
+    size_t j = 0;
+    run_both(runner, "find_hit", size, &zw_map, &std_map, [&](auto& map, uint64_t iterations) {
+        uint64_t sum = 0;
+        for(uint64_t i = 0; i < iterations; i++) {
+            sum += map.get(lookup_keys[j]);
+            if(++j == size) j = 0;
+        }
+        do_not_optimize(sum);
+    });
+    run_both(runner, "find_miss", size, &zw_map, &std_map, [&](auto& map, uint64_t iterations) {
+        uint64_t num_found = 0;
+        for(uint64_t i = 0; i < iterations; i++) {
+            num_found += map.contains(missing_keys[j]);
+            if(++j == size) j = 0;
+        }
+        do_not_optimize(num_found);
+    });
+    // Each key is inserted again right after it's erased, which keeps the map at the same size
+    run_both(runner, "erase_insert", size, &zw_map, &std_map, [&](auto& map, uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            map.remove(lookup_keys[j]);
+            map.insert(lookup_keys[j]);
+            if(++j == size) j = 0;
+        }
+        clobber_memory();
+    });
+}
+
+void bench_hash_map(Runner& runner) {
+    // Integer keys, from maps that fit in the L1 cache up to ones that only fit in memory
+    size_t max_size = (size_t)runner.options().max_map_size;
+    uint64_t state = 1;
+    Array<uint64_t> keys;
+    Array<uint64_t> missing_keys;
+    keys.reserve(max_size);
+    missing_keys.reserve(max_size);
+    for(size_t i = 0; i < max_size; i++) {
+        keys.push(random_u64(&state));
+        missing_keys.push(random_u64(&state));
+    }
+    for(size_t size = MIN_MAP_SIZE; size <= max_size; size *= 10) {
+        bench_map_size(runner, size, keys, missing_keys);
+    }
+
+    // String keys, which have to be hashed and compared byte by byte
+    Array<String> strings;
+    for(size_t i = 0; i < NUM_STRING_KEYS; i++) {
+        strings.push(zw_format("some/longer/key/{}", random_u64(&state)));
+    }
+    HashMap<StringSlice, uint32_t> string_map;
+    std::unordered_map<std::string_view, uint32_t> std_string_map;
+    for(size_t i = 0; i < NUM_STRING_KEYS; i++) {
+        string_map.insert(strings[i].as_slice(), (uint32_t)i);
+        std_string_map.emplace(std::string_view(strings[i].data(), strings[i].size()), (uint32_t)i);
+    }
+
+    runner.run("hash_map/find_string/1024/zw", [&](uint64_t iterations) {
+        uint64_t sum = 0;
+        for(uint64_t i = 0; i < iterations; i++) {
+            const String& key = strings[i & (NUM_STRING_KEYS - 1)];
+            sum += *string_map.get(key.as_slice()).unwrap();
+        }
+        do_not_optimize(sum);
+    });
+    runner.run("hash_map/find_string/1024/std", [&](uint64_t iterations) {
+        uint64_t sum = 0;
+        for(uint64_t i = 0; i < iterations; i++) {
+            const String& key = strings[i & (NUM_STRING_KEYS - 1)];
+            sum += std_string_map.find(std::string_view(key.data(), key.size()))->second;
+        }
+        do_not_optimize(sum);
+    });
+}
+
+};
@@ -0,0 +1,80 @@
+#include "bench.h"
+#include "array.h"
+#include "iter.h"
+
+namespace zw::bench {
+
+constexpr size_t NUM_ELEMENTS = 4096;
+
+// Each pair runs the same computation as an iterator chain and as the loop it should compile down to
+void bench_iter(Runner& runner) {
+    Array<uint32_t> values;
+    uint64_t state = 1;
+    for(size_t i = 0; i < NUM_ELEMENTS; i++) {
+        values.push((uint32_t)random_u64(&state));
+    }
+
+    runner.run("iter/map_filter_sum/4096/chain", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            uint64_t sum = 0;
+            for(uint32_t x: values.iter().map([](const uint32_t& x) { return x * 3; }).filter([](uint32_t x) { return x % 2 == 0; })) {
+                sum += x;
+            }
+            do_not_optimize(sum);
+        }
+    }, NUM_ELEMENTS * sizeof(uint32_t));
+    runner.run("iter/map_filter_sum/4096/loop", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            uint64_t sum = 0;
+            for(size_t j = 0; j < values.size(); j++) {
+                uint32_t x = values[j] * 3;
+                if(x % 2 == 0) {
+                    sum += x;
+                }
+            }
+            do_not_optimize(sum);
+        }
+    }, NUM_ELEMENTS * sizeof(uint32_t));
+
+    runner.run("iter/zip_dot/4096/chain", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            uint64_t sum = 0;
+            for(auto [x, y]: values.iter().zip(values.iter().skip(1))) {
+                sum += (uint64_t)x * y;
+            }
+            do_not_optimize(sum);
+        }
+    }, NUM_ELEMENTS * sizeof(uint32_t));
+    runner.run("iter/zip_dot/4096/loop", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            uint64_t sum = 0;
+            for(size_t j = 0; j + 1 < values.size(); j++) {
+                sum += (uint64_t)values[j] * values[j + 1];
+            }
+            do_not_optimize(sum);
+        }
+    }, NUM_ELEMENTS * sizeof(uint32_t));
+
+    runner.run("iter/map_collect/4096/chain", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            Array<uint64_t> squares = values.iter().map([](const uint32_t& x) { return (uint64_t)x * x; }).collect<Array<uint64_t>>();
+            do_not_optimize(squares.data());
+        }
+    }, NUM_ELEMENTS * sizeof(uint32_t));
+    runner.run("iter/map_collect/4096/loop", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            Array<uint64_t> squares;
+            squares.reserve(values.size());
+            for(size_t j = 0; j < values.size(); j++) {
+                squares.push((uint64_t)values[j] * values[j]);
+            }
+            do_not_optimize(squares.data());
+        }
+    }, NUM_ELEMENTS * sizeof(uint32_t));
+}
+
+};
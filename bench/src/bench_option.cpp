@@ -0,0 +1,50 @@
+#include <optional>
+
+#include "bench.h"
+#include "array.h"
+#include "option.h"
+#include "string_interner.h"
+
+namespace zw::bench {
+
+constexpr size_t NUM_OPTIONS = 65536;
+
+// Counts the present values in an array where three in four are present. Option<T> for types with a niche is
+// half the size of std::optional<T>, which pads the flag out to T's alignment, so fewer cache lines are read.
+template<typename O, typename T>
+static void bench_scan(Runner& runner, StringSlice name, T value) {
+    Array<O> options;
+    uint64_t state = 1;
+    for(size_t i = 0; i < NUM_OPTIONS; i++) {
+        if(random_u64(&state) % 4) {
+            T copy = value;
+            options.push(O(std::move(copy)));
+        } else {
+            options.push(O());
+        }
+    }
+    runner.run(name, [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            size_t num_present = 0;
+            for(size_t j = 0; j < options.size(); j++) {
+                if constexpr(std::is_same_v<O, std::optional<T>>) {
+                    num_present += options[j].has_value();
+                } else {
+                    num_present += options[j].is_present();
+                }
+            }
+            do_not_optimize(num_present);
+        }
+    });
+}
+
+void bench_option(Runner& runner) {
+    static uint32_t pointee;
+    bench_scan<Option<uint32_t*>>(runner, "option/scan/65536/pointer/zw", &pointee);
+    bench_scan<std::optional<uint32_t*>>(runner, "option/scan/65536/pointer/std", &pointee);
+    bench_scan<Option<Symbol>>(runner, "option/scan/65536/symbol/zw", Symbol { 1 });
+    bench_scan<std::optional<Symbol>>(runner, "option/scan/65536/symbol/std", Symbol { 1 });
+}
+
+};
@@ -0,0 +1,86 @@
+#include <stdlib.h>
+
+#include "bench.h"
+#include "array.h"
+#include "fmt.h"
+#include "parse.h"
+
+namespace zw::bench {
+
+constexpr size_t NUM_ROWS = 10000;
+
+// A column of a CSV document. The fields point into the document, where each is followed by a comma or a
+// newline, so strtod() and strtoll() can read them in place just as parse() does.
+struct Column {
+    Array<StringSlice> fields;
+    uint64_t num_bytes = 0;
+};
+
+void bench_parse(Runner& runner) {
+    // Rows of an id, a price with two decimals, and a ratio with all the digits it takes to round-trip
+    uint64_t state = 1;
+    String csv;
+    for(size_t i = 0; i < NUM_ROWS; i++) {
+        uint64_t id = random_u64(&state) % 100000000;
+        double price = (double)(random_u64(&state) % 10000000) / 100.0;
+        double ratio = (double)(random_u64(&state) >> 11) / (double)(1ull << 53);
+        csv.append(zw_format("{},{},{}\n", id, price, ratio).as_slice());
+    }
+    Column columns[3];
+    for(StringSlice line: csv.as_slice().lines()) {
+        size_t i = 0;
+        for(StringSlice field: line.split(',')) {
+            columns[i].fields.push(field);
+            columns[i].num_bytes += field.size();
+            i++;
+        }
+    }
+    Column& ids = columns[0];
+    Column& prices = columns[1];
+    Column& ratios = columns[2];
+
+    // One iteration parses the whole column
+    auto run_double = [&](const char* name, Column& column) {
+        runner.run(zw_format("parse/csv_{}/zw", name).as_slice(), [&](uint64_t iterations) {
+            for(uint64_t i = 0; i < iterations; i++) {
+                double sum = 0;
+                for(StringSlice field: column.fields.iter()) {
+                    sum += parse<double>(field).unwrap();
+                }
+                do_not_optimize(sum);
+            }
+        }, column.num_bytes);
+        runner.run(zw_format("parse/csv_{}/strtod", name).as_slice(), [&](uint64_t iterations) {
+            for(uint64_t i = 0; i < iterations; i++) {
+                double sum = 0;
+                for(StringSlice field: column.fields.iter()) {
+                    sum += strtod(field.data(), nullptr);
+                }
+                do_not_optimize(sum);
+            }
+        }, column.num_bytes);
+    };
+    run_double("price", prices);
+    run_double("ratio", ratios);
+
+    runner.run("parse/csv_id/zw", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            int64_t sum = 0;
+            for(StringSlice field: ids.fields.iter()) {
+                sum += parse<int64_t>(field).unwrap();
+            }
+            do_not_optimize(sum);
+        }
+    }, ids.num_bytes);
+    runner.run("parse/csv_id/strtoll", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            int64_t sum = 0;
+            for(StringSlice field: ids.fields.iter()) {
+                sum += strtoll(field.data(), nullptr, 10);
+            }
+            do_not_optimize(sum);
+        }
+    }, ids.num_bytes);
+}
+
+};
@@ -0,0 +1,172 @@
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "bench.h"
+#include "concurrent_queue.h"
+#include "fmt.h"
+
+namespace zw::bench {
+
+constexpr size_t QUEUE_CAP = 1024;
+constexpr uint32_t MAX_THREADS = 8;
+
+// Moves num_items items from the producers to the consumers, one at a time. Each consumer pops a fixed share of
+// the items, so that nobody has to keep a shared count. The calling thread is the first consumer.
+template<typename Push, typename Pop>
+static void transfer(uint64_t num_items, uint32_t num_producers, uint32_t num_consumers, Push& push, Pop& pop) {
+    auto produce = [&](uint32_t producer) {
+        uint64_t end = num_items * (producer + 1) / num_producers;
+        for(uint64_t i = num_items * producer / num_producers; i < end; i++) {
+            while(!push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    };
+    auto consume = [&](uint32_t consumer) {
+        uint64_t count = num_items * (consumer + 1) / num_consumers - num_items * consumer / num_consumers;
+        uint64_t sum = 0;
+        while(count) {
+            Option<uint64_t> item = pop();
+            if(item.is_present()) {
+                sum += item.unwrap();
+                count--;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        do_not_optimize(sum);
+    };
+
+    std::thread threads[MAX_THREADS];
+    uint32_t num_threads = 0;
+    for(uint32_t i = 0; i < num_producers; i++) {
+        threads[num_threads++] = std::thread(produce, i);
+    }
+    for(uint32_t i = 1; i < num_consumers; i++) {
+        threads[num_threads++] = std::thread(consume, i);
+    }
+    consume(0);
+    for(uint32_t i = 0; i < num_threads; i++) {
+        threads[i].join();
+    }
+}
+
+// The usual baseline: a deque behind a mutex, bounded like the lock-free queues
+class LockedQueue {
+    std::mutex _lock;
+    std::deque<uint64_t> _items;
+
+public:
+    bool try_push(uint64_t item) {
+        std::lock_guard<std::mutex> lock(_lock);
+        if(_items.size() == QUEUE_CAP) return false;
+        _items.push_back(item);
+        return true;
+    }
+
+    Option<uint64_t> try_pop() {
+        std::lock_guard<std::mutex> lock(_lock);
+        if(_items.empty()) return {};
+        Option<uint64_t> result = std::move(_items.front());
+        _items.pop_front();
+        return result;
+    }
+};
+
+template<typename Queue>
+static void bench_transfer(Runner& runner, StringSlice name, Queue& queue, uint32_t num_producers, uint32_t num_consumers) {
+    auto push = [&](uint64_t item) { return queue.try_push(item); };
+    auto pop = [&]() { return queue.try_pop(); };
+    runner.run(zw_format("queue/transfer/{}x{}/{}", num_producers, num_consumers, name).as_slice(), [&](uint64_t iterations) {
+        transfer(iterations, num_producers, num_consumers, push, pop);
+    }, sizeof(uint64_t));
+}
+
+// Polls for a while before yielding, so that latency isn't mostly the scheduler's, while still letting the
+// other thread run on a machine without a core to spare
+constexpr uint32_t SPINS_BEFORE_YIELDING = 1000;
+
+template<typename Queue>
+static uint64_t pop_waiting(Queue& queue) {
+    for(uint32_t spins = 0;; spins++) {
+        Option<uint64_t> item = queue.try_pop();
+        if(item.is_present()) return item.unwrap();
+        if(spins >= SPINS_BEFORE_YIELDING) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+template<typename Queue>
+static void push_waiting(Queue& queue, uint64_t item) {
+    while(!queue.try_push(item)) {
+        std::this_thread::yield();
+    }
+}
+
+// Latency rather than throughput: one iteration sends an item to another thread through one queue and waits
+// for it to come back through another, so there's never more than one item in flight
+template<typename Queue>
+static void bench_round_trip(Runner& runner, StringSlice name, Queue& there, Queue& back) {
+    constexpr uint64_t STOP = UINT64_MAX;
+    std::thread echo([&] {
+        for(;;) {
+            uint64_t item = pop_waiting(there);
+            push_waiting(back, item);
+            if(item == STOP) return;
+        }
+    });
+    runner.run(zw_format("queue/round_trip/{}", name).as_slice(), [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            push_waiting(there, i);
+            do_not_optimize(pop_waiting(back));
+        }
+    });
+    push_waiting(there, STOP);
+    pop_waiting(back);
+    echo.join();
+}
+
+void bench_queue(Runner& runner) {
+    // Uncontended cost of a push and a pop on the same thread
+    SpscQueue<uint64_t> spsc(QUEUE_CAP);
+    MpmcQueue<uint64_t> mpmc(QUEUE_CAP);
+    LockedQueue locked;
+    runner.run("queue/push_pop/spsc", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            spsc.try_push(i);
+            do_not_optimize(spsc.try_pop());
+        }
+    });
+    runner.run("queue/push_pop/mpmc", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            mpmc.try_push(i);
+            do_not_optimize(mpmc.try_pop());
+        }
+    });
+    runner.run("queue/push_pop/locked", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            locked.try_push(i);
+            do_not_optimize(locked.try_pop());
+        }
+    });
+
+    bench_transfer(runner, "spsc", spsc, 1, 1);
+    bench_transfer(runner, "mpmc", mpmc, 1, 1);
+    bench_transfer(runner, "locked", locked, 1, 1);
+    bench_transfer(runner, "mpmc", mpmc, 2, 2);
+    bench_transfer(runner, "locked", locked, 2, 2);
+    bench_transfer(runner, "mpmc", mpmc, 4, 4);
+    bench_transfer(runner, "locked", locked, 4, 4);
+
+    SpscQueue<uint64_t> spsc_back(QUEUE_CAP);
+    MpmcQueue<uint64_t> mpmc_back(QUEUE_CAP);
+    LockedQueue locked_back;
+    bench_round_trip(runner, "spsc", spsc, spsc_back);
+    bench_round_trip(runner, "mpmc", mpmc, mpmc_back);
+    bench_round_trip(runner, "locked", locked, locked_back);
+}
+
+};
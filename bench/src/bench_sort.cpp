@@ -0,0 +1,56 @@
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+
+#include "bench.h"
+#include "array.h"
+#include "fmt.h"
+#include "sort.h"
+
+namespace zw::bench {
+
+// One iteration copies the unsorted input over the array being sorted and sorts it. The copy is a small part
+// of the time at every size.
+template<typename T>
+static void bench_sort_type(Runner& runner, const char* type_name, size_t size) {
+    uint64_t state = size;
+    Array<T> input;
+    input.reserve(size);
+    for(size_t i = 0; i < size; i++) {
+        input.push((T)random_u64(&state));
+    }
+    Array<T> data;
+    data.resize(size);
+
+    auto run_sort = [&](const char* algorithm, auto sort_data) {
+        String name = zw_format("sort/{}/{}/{}", type_name, size, algorithm);
+        if(runner.is_timing(name.as_slice())) {
+            // Whatever temp memory a sort takes, it has to give back
+            memcpy(data.data(), input.data(), size * sizeof(T));
+            [[maybe_unused]] size_t temp_used = temp_allocator.used();
+            sort_data(data.data(), size);
+            assert(temp_allocator.used() == temp_used && "sort kept temp memory");
+        }
+
+        runner.run(name.as_slice(), [&](uint64_t iterations) {
+            for(uint64_t i = 0; i < iterations; i++) {
+                memcpy(data.data(), input.data(), size * sizeof(T));
+                sort_data(data.data(), size);
+                do_not_optimize(data[0]);
+            }
+        }, size * sizeof(T));
+    };
+    run_sort("radix", [](T* data, size_t size) { radix_sort(data, size); });
+    run_sort("pdq", [](T* data, size_t size) { sort(data, size); });
+    run_sort("stable", [](T* data, size_t size) { stable_sort(data, size); });
+    run_sort("std", [](T* data, size_t size) { std::sort(data, data + size); });
+}
+
+void bench_sort(Runner& runner) {
+    for(size_t size: {(size_t)1000, (size_t)100000, (size_t)4000000}) {
+        bench_sort_type<uint32_t>(runner, "u32", size);
+        bench_sort_type<uint64_t>(runner, "u64", size);
+    }
+}
+
+};
@@ -0,0 +1,92 @@
+#include <string>
+
+#include "bench.h"
+#include "string.h"
+
+namespace zw::bench {
+
+constexpr uint32_t NUM_APPENDS = 100;
+constexpr size_t COMPARE_SIZE = 64;
+
+void bench_string(Runner& runner) {
+    runner.run("string/append_word/100/zw", [](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            String string;
+            for(uint32_t j = 0; j < NUM_APPENDS; j++) {
+                string.append("word ");
+            }
+            do_not_optimize(string);
+        }
+    });
+    runner.run("string/append_word/100/std", [](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            std::string string;
+            for(uint32_t j = 0; j < NUM_APPENDS; j++) {
+                string.append("word ");
+            }
+            do_not_optimize(string);
+        }
+    });
+
+    // Short enough to stay inline in both
+    runner.run("string/construct_short/zw", [](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            String string("short string");
+            do_not_optimize(string);
+        }
+    });
+    runner.run("string/construct_short/std", [](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            std::string string("short string");
+            do_not_optimize(string);
+        }
+    });
+
+    // Strings that only differ in their last character, so that all of them has to be compared
+    String left;
+    String right;
+    std::string std_left;
+    std::string std_right;
+    for(size_t i = 0; i + 1 < COMPARE_SIZE; i++) {
+        char c = (char)('a' + i % 26);
+        left.push(c);
+        right.push(c);
+        std_left.push_back(c);
+        std_right.push_back(c);
+    }
+    left.push('a');
+    right.push('b');
+    std_left.push_back('a');
+    std_right.push_back('b');
+
+    runner.run("string/equal/64/zw", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            bool is_equal = left == right.as_slice();
+            do_not_optimize(is_equal);
+        }
+    });
+    runner.run("string/equal/64/std", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            bool is_equal = std_left == std_right;
+            do_not_optimize(is_equal);
+        }
+    });
+    runner.run("string/compare/64/zw", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            int order = left.compare(right.as_slice());
+            do_not_optimize(order);
+        }
+    });
+    runner.run("string/compare/64/std", [&](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            clobber_memory();
+            int order = std_left.compare(std_right);
+            do_not_optimize(order);
+        }
+    });
+}
+
+};
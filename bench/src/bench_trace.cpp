@@ -0,0 +1,31 @@
+#include "bench.h"
+#include "trace.h"
+
+namespace zw::bench {
+
+void bench_trace(Runner& runner) {
+    runner.run("trace/scope/disabled", [](uint64_t iterations) {
+        for(uint64_t i = 0; i < iterations; i++) {
+            zw_trace_scope("scope");
+            clobber_memory();
+        }
+    });
+    // A fresh tracer for each sample, so that the events don't pile up across the run
+    runner.run("trace/scope/enabled", [](uint64_t iterations) {
+        Tracer tracer;
+        zw_set_ctx(tracer, &tracer);
+        for(uint64_t i = 0; i < iterations; i++) {
+            zw_trace_scope("scope");
+            clobber_memory();
+        }
+    });
+    runner.run("trace/instant/enabled", [](uint64_t iterations) {
+        Tracer tracer;
+        zw_set_ctx(tracer, &tracer);
+        for(uint64_t i = 0; i < iterations; i++) {
+            zw_trace_instant("instant", i);
+        }
+    });
+}
+
+};
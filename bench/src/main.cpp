@@ -0,0 +1,94 @@
+#include "bench.h"
+#include "fmt.h"
+#include "parse.h"
+
+using namespace zw;
+using namespace zw::bench;
+
+static void print_usage() {
+    zw_println("Usage: zw_bench [options]");
+    zw_println("  --filter=TEXT         only run benchmarks whose names contain TEXT");
+    zw_println("  --format=text|json|csv");
+    zw_println("  --samples=N           timed samples per benchmark (default 51)");
+    zw_println("  --warmup=N            untimed samples per benchmark (default 5)");
+    zw_println("  --min-sample-ms=N     minimum time per sample (default 2)");
+    zw_println("  --max-run-ms=N        time to fit the samples of a slow benchmark in (default 10000)");
+    zw_println("  --max-map-size=N      largest number of entries in hash map benchmarks (default 10000000)");
+    zw_println("  --list                print benchmark names without running them");
+}
+
+// Returns the value of an option of the form --name=value, if arg is one
+static Option<StringSlice> option_value(StringSlice arg, StringSlice name) {
+    if(arg.starts_with(name) && arg.size() > name.size() && arg[name.size()] == '=') {
+        return arg[Range(name.size() + 1, arg.size())];
+    }
+    return none<StringSlice>();
+}
+
+static bool parse_args(int argc, char** argv, Options* options) {
+    for(int i = 1; i < argc; i++) {
+        StringSlice arg(argv[i]);
+        if(auto value = option_value(arg, "--filter"); value.is_present()) {
+            options->filter = value.unwrap();
+        } else if(auto value = option_value(arg, "--format"); value.is_present()) {
+            if(value.unwrap() == "text") {
+                options->format = OutputFormat::TEXT;
+            } else if(value.unwrap() == "json") {
+                options->format = OutputFormat::JSON;
+            } else if(value.unwrap() == "csv") {
+                options->format = OutputFormat::CSV;
+            } else {
+                return false;
+            }
+        } else if(auto value = option_value(arg, "--samples"); value.is_present()) {
+            Option<uint32_t> samples = parse<uint32_t>(value.unwrap());
+            if(!samples.is_present() || !samples.unwrap()) return false;
+            options->samples = samples.unwrap();
+        } else if(auto value = option_value(arg, "--warmup"); value.is_present()) {
+            Option<uint32_t> warmup = parse<uint32_t>(value.unwrap());
+            if(!warmup.is_present()) return false;
+            options->warmup_samples = warmup.unwrap();
+        } else if(auto value = option_value(arg, "--min-sample-ms"); value.is_present()) {
+            Option<uint64_t> ms = parse<uint64_t>(value.unwrap());
+            if(!ms.is_present()) return false;
+            options->min_sample_ns = ms.unwrap() * 1000000;
+        } else if(auto value = option_value(arg, "--max-run-ms"); value.is_present()) {
+            Option<uint64_t> ms = parse<uint64_t>(value.unwrap());
+            if(!ms.is_present()) return false;
+            options->max_run_ns = ms.unwrap() * 1000000;
+        } else if(auto value = option_value(arg, "--max-map-size"); value.is_present()) {
+            Option<uint64_t> size = parse<uint64_t>(value.unwrap());
+            if(!size.is_present() || size.unwrap() < 1000) return false;
+            options->max_map_size = size.unwrap();
+        } else if(arg == "--list") {
+            options->is_listing = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if(!parse_args(argc, argv, &options)) {
+        print_usage();
+        return 1;
+    }
+
+    Runner runner(options);
+    bench_alloc(runner);
+    bench_array(runner);
+    bench_string(runner);
+    bench_fmt(runner);
+    bench_context(runner);
+    bench_hash_map(runner);
+    bench_hash(runner);
+    bench_queue(runner);
+    bench_iter(runner);
+    bench_option(runner);
+    bench_trace(runner);
+    bench_sort(runner);
+    bench_parse(runner);
+    return 0;
+}
@@ -1,21 +1,36 @@
 #include <stdlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <atomic>
+#endif
 
 #include "alloc.h"
 #include "context.h"
 #include "misc.h"
 #include "fmt.h"
+#include "trace.h"
 
 ZW_DEFINE_CTX_VAR(zw::Allocator*, allocator, &zw::global_allocator);
 ZW_DEFINE_CTX_VAR(zw::Allocator*, temp_allocator, &zw::temp_allocator);
 ZW_DEFINE_CTX_VAR(bool, is_explicitly_copying, false);
 
 void* zw_alloc(zw::Allocator* allocator, size_t size, size_t alignment) {
+    #ifdef ZW_TRACE_ALLOCATIONS
+    zw_trace_instant("zw_alloc", size);
+    #endif
     return allocator->alloc(size, alignment);
 }
 void zw_free(zw::Allocator* allocator, void* address) {
+    #ifdef ZW_TRACE_ALLOCATIONS
+    zw_trace_instant("zw_free");
+    #endif
     allocator->free(address);
 }
 void* zw_realloc(zw::Allocator* allocator, void* address, size_t size, size_t alignment) {
+    #ifdef ZW_TRACE_ALLOCATIONS
+    zw_trace_instant("zw_realloc", size);
+    #endif
     return allocator->realloc(address, size, alignment);
 }
 void zw_alloc_reset(zw::Allocator* allocator) {
@@ -23,26 +38,26 @@ void zw_alloc_reset(zw::Allocator* allocator) {
 }
 
 void* zw_alloc(size_t size, size_t alignment) {
-    return zw_get_ctx(allocator)->alloc(size, alignment);
+    return zw_alloc(zw_get_ctx(allocator), size, alignment);
 }
 void zw_free(void* address) {
-    zw_get_ctx(allocator)->free(address);
+    zw_free(zw_get_ctx(allocator), address);
 }
 void* zw_realloc(void* address, size_t size, size_t alignment) {
-    return zw_get_ctx(allocator)->realloc(address, size, alignment);
+    return zw_realloc(zw_get_ctx(allocator), address, size, alignment);
 }
 void zw_alloc_reset() {
     zw_get_ctx(allocator)->reset();
 }
 
 void* zw_temp_alloc(size_t size, size_t alignment) {
-    return zw_get_ctx(temp_allocator)->alloc(size, alignment);
+    return zw_alloc(zw_get_ctx(temp_allocator), size, alignment);
 }
 void zw_temp_free(void* address) {
-    zw_get_ctx(temp_allocator)->free(address);
+    zw_free(zw_get_ctx(temp_allocator), address);
 }
 void* zw_temp_realloc(void* address, size_t size, size_t alignment) {
-    return zw_get_ctx(temp_allocator)->realloc(address, size, alignment);
+    return zw_realloc(zw_get_ctx(temp_allocator), address, size, alignment);
 }
 void zw_temp_alloc_reset() {
     zw_get_ctx(temp_allocator)->reset();
@@ -51,12 +66,17 @@ void zw_temp_alloc_reset() {
 namespace zw {
 
 static uint32_t get_thread_id() {
-    // TODO: cross-platform
+#ifdef _WIN32
     return CoGetCurrentProcess();
+#else
+    static std::atomic<uint32_t> num_threads {0};
+    static thread_local uint32_t id = ++num_threads;
+    return id;
+#endif
 }
 
 GlobalAllocator global_allocator {};
-extern thread_local InlineAllocator<DEFAULT_TEMP_ALLOCATOR_SIZE> temp_allocator {};
+thread_local InlineAllocator<DEFAULT_TEMP_ALLOCATOR_SIZE> temp_allocator {};
 
 // Global allocator takes up one spot
 static thread_local uint32_t allocator_count = 1;
@@ -82,7 +102,7 @@ AllocationHeader* find_header(Address address) {
 
 void Allocator::check_header(void* address) {
     #ifdef ZW_ALLOC_SAFETY
-    AllocationHeader* header = find_header(address);
+    [[maybe_unused]] AllocationHeader* header = find_header(address);
     assert(header->allocator_id == allocator_id);
     assert(header->thread_id == thread_id);
     #endif
@@ -120,7 +140,8 @@ void* GlobalAllocator::realloc(void* address, size_t size, size_t alignment) {
     void* new_base = ::realloc(header->base, size + sizeof(AllocationHeader) + alignment);
     if(!new_base) return nullptr;
     if(new_base == original_base) {
-        header->size = size;
+        // Only the pointer realloc returned may be used, even when the address is the same
+        find_header((uintptr_t)new_base + original_offset)->size = size;
         return address;
     } else {
         // Uh-oh, realloc had to move to another location. That might have messed with the alignment.
@@ -173,6 +194,7 @@ void* LinearAllocator::alloc(size_t size, size_t alignment) {
         header->allocator_id = allocator_id;
         header->thread_id = thread_id;
         #endif
+        previous_bump = bump;
         bump += padded_size;
         previous_allocation = (void*)address;
         return (void*)address;
@@ -209,16 +231,24 @@ void* LinearAllocator::realloc(void* address, size_t size, size_t alignment) {
 }
 void LinearAllocator::free(void* address) {
     check_header(address);
+
+    // Only the most recent allocation can be given back
+    if(previous_allocation == address) {
+        bump = previous_bump;
+        previous_allocation = nullptr;
+    }
 }
 void LinearAllocator::reset() {
     bump = 0;
     previous_allocation = 0;
+    previous_bump = 0;
 }
 
 // ArenaAllocator
 void ArenaAllocator::init() {
-    block_size = max(block_size, sizeof(void*));
-    block_alignment = max(block_alignment, alignof(void*));
+    // Free blocks hold the pointer to the next one
+    if(block_size < sizeof(void*)) block_size = sizeof(void*);
+    if(block_alignment < alignof(void*)) block_alignment = alignof(void*);
     void* prev_allocation = nullptr;
     while(void* next_allocation = LinearAllocator::alloc(block_size, block_alignment)) {
         void** free_node = (void**)next_allocation;
@@ -227,7 +257,7 @@ void ArenaAllocator::init() {
     }
     first_free_block = prev_allocation;
 }
-void* ArenaAllocator::alloc(size_t size, size_t alignment) {
+void* ArenaAllocator::alloc([[maybe_unused]] size_t size, [[maybe_unused]] size_t alignment) {
     assert(size <= block_size);
     assert(alignment <= block_alignment);
     if(first_free_block) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <utility>
 
@@ -21,6 +22,8 @@ ZW_DECLARE_CTX_VAR(bool, is_explicitly_copying);
 
 #define ZW_ALLOC_SAFETY
 #define ZW_AUDIT_IMPLICIT_COPIES
+// Define ZW_TRACE_ALLOCATIONS to record every zw_alloc, zw_realloc and zw_free as an instant event in the
+// context tracer (see trace.h)
 
 // These are the main entry points to the allocator API
 
@@ -106,7 +109,7 @@ void zw_destroy_with_alloc(zw::Allocator* allocator, Value* value) {
 struct ZwObject {
     #ifdef ZW_AUDIT_IMPLICIT_COPIES
     ZwObject() = default;
-    ZwObject(const ZwObject& other) {
+    ZwObject(const ZwObject&) {
         assert(zw_get_ctx(is_explicitly_copying));
     }
     #endif
@@ -171,6 +174,8 @@ protected:
     size_t bump = 0;
     size_t size = 0;
     void* previous_allocation = nullptr;
+    // Where bump was before previous_allocation, so that freeing it gives its space back
+    size_t previous_bump = 0;
 public:
 #ifdef ZW_ALLOC_SAFETY
     LinearAllocator(uint8_t* buffer, size_t size);
@@ -183,6 +188,9 @@ public:
     void* realloc(void* address, size_t size, size_t alignment) override;
 
     void reset() override;
+
+    /// Bytes allocated since the last reset, including headers and alignment padding
+    size_t used() const { return bump; }
 };
 
 template<size_t Size>
@@ -202,7 +210,7 @@ protected:
     void* first_free_block;
     void init();
 public:
-    ArenaAllocator(uint8_t* buffer, size_t buffer_size, size_t block_size, size_t block_alignment) : LinearAllocator(buffer, buffer_size), block_size(block_size), block_alignment(block_alignment), first_free_block(first_free_block) {
+    ArenaAllocator(uint8_t* buffer, size_t buffer_size, size_t block_size, size_t block_alignment) : LinearAllocator(buffer, buffer_size), block_size(block_size), block_alignment(block_alignment), first_free_block(nullptr) {
         init();
     }
 
@@ -3,51 +3,13 @@
 #include <utility>
 #include <assert.h>
 #include "alloc.h"
+#include "iter.h"
+#include "option.h"
 #include "range.h"
+#include "sort.h"
 
 namespace zw {
 
-template<typename Iter>
-class EnumerateIterator {
-    size_t number;
-    Iter iter;
-public:
-    using Element = std::pair<size_t, typename Iter::Element>;
-
-    EnumerateIterator(Iter&& iter) : number(0), iter(std::move(iter)) {}
-
-    EnumerateIterator<Iter>& operator++() {
-        ++iter;
-        ++number;
-        return *this;
-    }
-
-    bool operator==(const EnumerateIterator<Iter>& other) const { return iter == other.iter; }
-    bool operator!=(const EnumerateIterator<Iter>& other) const { return iter != other.iter; }
-    Element operator*() {
-        return std::make_pair(number, *iter);
-    }
-};
-
-template<typename Iter>
-class EnumerateIterable {
-    Iter iterable;
-public:
-    EnumerateIterable(Iter&& iterable) : iterable(std::move(iterable)) {}
-    using Iterator = EnumerateIterator<typename Iter::Iterator>;
-
-    Iterator begin() const { return Iterator(iterable.begin()); }
-    Iterator end() const { return Iterator(iterable.end()); }
-};
-
-template<typename Iter>
-class Iterable {
-public:
-    auto enumerate() {
-        return EnumerateIterable(std::move(*static_cast<Iter*>(this)));
-    }
-};
-
 template<typename T>
 class ConstArrayIterator {
     const T* loc;
@@ -69,15 +31,21 @@ public:
 
 template<typename T>
 class ConstArrayIterable: public Iterable<ConstArrayIterable<T>> {
-    const T* data;
-    size_t size;
+    const T* _data;
+    size_t _size;
 
 public:
     using Iterator = ConstArrayIterator<T>;
 
-    ConstArrayIterable(const T* data, size_t size) : data(data), size(size) {}
-    Iterator begin() const { return data; }
-    Iterator end() const { return data + size; }
+    ConstArrayIterable(const T* data, size_t size) : _data(data), _size(size) {}
+    Iterator begin() const { return _data; }
+    Iterator end() const { return _data + _size; }
+    size_t size() const { return _size; }
+    size_t size_hint() const { return _size; }
+    ConstArrayIterable<T> subrange(size_t begin, size_t end) const {
+        assert(begin <= end && end <= _size);
+        return {_data + begin, end - begin};
+    }
 };
 
 template<typename T>
@@ -101,14 +69,20 @@ public:
 
 template<typename T>
 class MutArrayIterable: public Iterable<MutArrayIterable<T>> {
-    T* data;
-    size_t size;
+    T* _data;
+    size_t _size;
 
 public:
     using Iterator = MutArrayIterator<T>;
-    MutArrayIterable(T* data, size_t size) : data(data), size(size) {}
-    MutArrayIterator<T> begin() const { return data; }
-    MutArrayIterator<T> end() const { return data + size; }
+    MutArrayIterable(T* data, size_t size) : _data(data), _size(size) {}
+    MutArrayIterator<T> begin() const { return _data; }
+    MutArrayIterator<T> end() const { return _data + _size; }
+    size_t size() const { return _size; }
+    size_t size_hint() const { return _size; }
+    MutArrayIterable<T> subrange(size_t begin, size_t end) const {
+        assert(begin <= end && end <= _size);
+        return {_data + begin, end - begin};
+    }
 };
 
 template<typename T>
@@ -116,7 +90,7 @@ class MoveArrayIterator {
     T* loc;
 
 public:
-    using Element = T&;
+    using Element = T&&;
 
     MoveArrayIterator(T* loc) : loc(loc) {}
 
@@ -127,7 +101,7 @@ public:
 
     bool operator==(const MoveArrayIterator<T>& other) const { return loc == other.loc; }
     bool operator!=(const MoveArrayIterator<T>& other) const { return loc != other.loc; }
-    T& operator*() { return *loc; }
+    T&& operator*() { return std::move(*loc); }
 };
 
 template<typename T>
@@ -151,6 +125,7 @@ public:
     }
     MoveArrayIterator<T> begin() const { return data; }
     MoveArrayIterator<T> end() const { return data + size; }
+    size_t size_hint() const { return size; }
     ~MoveArrayIterable() {
         Array<T> temp(data, size, size);
     }
@@ -176,6 +151,7 @@ class Array: ZwObject {
     }
 
     friend class MoveArrayIterable<T>;
+    friend struct OptionNiche<Array<T>>;
     Array(T* data, size_t size, size_t cap) : _data(data), _size(size), _cap(cap) {}
 
     void open_gap(size_t index) {
@@ -389,6 +365,42 @@ public:
 
     bool is_empty() const { return _size == 0; }
 
+    void sort() { zw::sort(_data, _size); }
+    template<typename F>
+    void sort_by(F less) { zw::sort_by(_data, _size, less); }
+    void stable_sort() { zw::stable_sort(_data, _size); }
+    template<typename F>
+    void stable_sort_by(F less) { zw::stable_sort_by(_data, _size, less); }
+    void radix_sort() requires RadixKey<T> { zw::radix_sort(_data, _size); }
+    template<typename F>
+    void radix_sort_by_key(F key) { zw::radix_sort_by_key(_data, _size, key); }
+
+    // The following require the array to be sorted with respect to less.
+
+    /// Returns the index of an element equal to value, if there is one.
+    template<typename Q, typename F = Less>
+    Option<size_t> binary_search(const Q& value, F less = F()) const {
+        size_t index = impl::lower_bound(_data, _size, value, less);
+        if(index < _size && !less(value, _data[index])) {
+            return index;
+        }
+        return {};
+    }
+    /// Returns the index of the first element not less than value, if there is one.
+    template<typename Q, typename F = Less>
+    Option<size_t> lower_bound(const Q& value, F less = F()) const {
+        size_t index = impl::lower_bound(_data, _size, value, less);
+        if(index < _size) return index;
+        return {};
+    }
+    /// Returns the index of the first element greater than value, if there is one.
+    template<typename Q, typename F = Less>
+    Option<size_t> upper_bound(const Q& value, F less = F()) const {
+        size_t index = impl::upper_bound(_data, _size, value, less);
+        if(index < _size) return index;
+        return {};
+    }
+
     // Don't call unless you know what you are doing!
     void unsafe_set_size(size_t size) {
         _size = size;
@@ -401,4 +413,17 @@ public:
     }
 };
 
+/// An array never has more elements than room for them.
+template<typename T>
+struct OptionNiche<Array<T>> {
+    static constexpr bool HAS_NICHE = true;
+    static void set_none(Array<T>* storage) {
+        storage->_size = 1;
+        storage->_cap = 0;
+    }
+    static bool is_none(const Array<T>* storage) { return storage->_size > storage->_cap; }
+};
+
+static_assert(sizeof(Option<Array<int>>) == sizeof(Array<int>));
+
 }
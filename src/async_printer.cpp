@@ -0,0 +1,312 @@
+#include <assert.h>
+#include <string.h>
+#include <bit>
+#include <chrono>
+
+#include "async_printer.h"
+#include "misc.h"
+
+namespace zw {
+
+constexpr size_t RECORD_ALIGNMENT = 16;
+// Set in a ring's write position once it has been replaced by a bigger one, so that no more records go into it
+constexpr uint64_t SEALED = (uint64_t)1 << 63;
+// Set in a ring's write position while a print too big for one record is being split up, so that only the
+// thread printing it can reserve records until it's done
+constexpr uint64_t LOCKED = (uint64_t)1 << 62;
+constexpr uint64_t POSITION_FLAGS = SEALED | LOCKED;
+// Times the writer thread checks for records again before it starts sleeping between checks
+constexpr uint32_t MAX_IDLE_POLLS = 256;
+
+enum RecordKind: uint32_t {
+    TEXT,
+    // Fills the end of the ring when the next record doesn't fit there
+    PADDING,
+    // Syncs the sink. Whoever pushed it waits for the read position to move past it.
+    FLUSH,
+    STOP,
+};
+
+struct RecordHeader {
+    // The record's position plus one, once it has been published. The writer thread zeroes the first word
+    // of every slot a record took up before giving its room back, so whatever an unpublished header holds,
+    // whether an older header or the middle of an older payload, never matches.
+    uint64_t sequence;
+    uint32_t payload_size;
+    uint32_t kind;
+};
+static_assert(sizeof(RecordHeader) == RECORD_ALIGNMENT);
+
+static size_t record_size(size_t payload_size) {
+    return (sizeof(RecordHeader) + payload_size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+}
+
+struct AsyncPrinter::Ring {
+    Allocator* allocator;
+    char* data;
+    size_t mask;
+    std::atomic<Ring*> next {nullptr};
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> write_pos {0};
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> read_pos {0};
+
+    Ring(Allocator* allocator, size_t cap) : allocator(allocator), mask(cap - 1) {
+        data = (char*)zw_alloc(allocator, cap, RECORD_ALIGNMENT);
+        assert(data && "allocator out of memory");
+        // No header may look published before it's written
+        memset(data, 0, cap);
+    }
+    ~Ring() {
+        zw_free(allocator, data);
+    }
+
+    size_t cap() const { return mask + 1; }
+    // Records can always be placed in an empty ring if they're at most half its size, wherever it starts
+    size_t max_record_size() const { return cap() / 2; }
+    RecordHeader* header_at(uint64_t pos) { return (RecordHeader*)(data + (pos & mask)); }
+};
+
+static void publish_header(RecordHeader* header, uint64_t pos) {
+    std::atomic_ref<uint64_t>(header->sequence).store(pos + 1, std::memory_order_release);
+}
+
+AsyncPrinter::AsyncPrinter(Printer* sink, FullPolicy policy, size_t cap, Allocator* allocator) : _sink(sink), _allocator(allocator), _policy(policy), _is_running(true) {
+    size_t ring_cap = std::bit_ceil(cap < 4 * RECORD_ALIGNMENT ? 4 * RECORD_ALIGNMENT : cap);
+    _first_ring = zw_make_with_alloc<Ring>(_allocator, _allocator, ring_cap);
+    assert(_first_ring && "allocator out of memory");
+    _ring.store(_first_ring, std::memory_order_relaxed);
+    _writer = std::thread([this] { write_records(); });
+}
+
+AsyncPrinter::~AsyncPrinter() {
+    shutdown();
+    Ring* ring = _first_ring;
+    while(ring) {
+        Ring* next = ring->next.load(std::memory_order_relaxed);
+        zw_destroy_with_alloc(_allocator, ring);
+        ring = next;
+    }
+}
+
+// Reserves a record with room for payload_size bytes, returning where to write them, or null if the record
+// was dropped. The record must then be published. has_lock says whether the calling thread has locked the
+// ring with lock_ring(); other threads wait for it to be unlocked.
+char* AsyncPrinter::reserve(size_t payload_size, uint32_t kind, Ring** reserved_ring, uint64_t* position, bool has_lock) {
+    size_t size = record_size(payload_size);
+    for(;;) {
+        Ring* ring = _ring.load(std::memory_order_acquire);
+        uint64_t pos = ring->write_pos.load(std::memory_order_relaxed);
+        while(!(pos & SEALED) && (has_lock || !(pos & LOCKED))) {
+            // The flags are left alone by the CAS below, since they're far above any position
+            uint64_t record_pos = pos & ~POSITION_FLAGS;
+            size_t offset = record_pos & ring->mask;
+            size_t padding = offset + size > ring->cap() ? ring->cap() - offset : 0;
+            if(size > ring->max_record_size() || record_pos + padding + size - ring->read_pos.load(std::memory_order_acquire) > ring->cap()) {
+                break;
+            }
+            if(ring->write_pos.compare_exchange_weak(pos, pos + padding + size, std::memory_order_relaxed)) {
+                if(padding) {
+                    RecordHeader* filler = ring->header_at(record_pos);
+                    filler->payload_size = (uint32_t)(padding - sizeof(RecordHeader));
+                    filler->kind = PADDING;
+                    publish_header(filler, record_pos);
+                    record_pos += padding;
+                }
+                RecordHeader* header = ring->header_at(record_pos);
+                header->payload_size = (uint32_t)payload_size;
+                header->kind = kind;
+                *reserved_ring = ring;
+                *position = record_pos;
+                return (char*)(header + 1);
+            }
+        }
+        if(pos & SEALED) {
+            // Another thread replaced the ring
+            continue;
+        }
+        if((pos & LOCKED) && !has_lock) {
+            // Another thread is splitting up a print
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Full
+        if(_policy == FullPolicy::GROW) {
+            std::lock_guard<std::mutex> lock(_grow_lock);
+            if(_ring.load(std::memory_order_relaxed) == ring) {
+                size_t cap = ring->cap() * 2;
+                while(cap / 2 < size) {
+                    cap *= 2;
+                }
+                Ring* bigger = zw_make_with_alloc<Ring>(_allocator, _allocator, cap);
+                assert(bigger && "allocator out of memory");
+                // Sealing fixes the old ring's final write position before the writer thread can see that there's
+                // a next ring to move on to
+                ring->write_pos.fetch_or(SEALED, std::memory_order_relaxed);
+                ring->next.store(bigger, std::memory_order_release);
+                _ring.store(bigger, std::memory_order_release);
+            }
+        } else if(_policy == FullPolicy::DROP && kind == TEXT) {
+            _num_dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void AsyncPrinter::publish(char* payload, uint64_t position) {
+    publish_header((RecordHeader*)payload - 1, position);
+}
+
+// Makes the calling thread the only one that can reserve records in the ring, until unlock_ring(). Only used
+// under FullPolicy::BLOCK, which never replaces the ring.
+AsyncPrinter::Ring* AsyncPrinter::lock_ring() {
+    Ring* ring = _ring.load(std::memory_order_acquire);
+    uint64_t pos = ring->write_pos.load(std::memory_order_relaxed);
+    for(;;) {
+        if(pos & LOCKED) {
+            std::this_thread::yield();
+            pos = ring->write_pos.load(std::memory_order_relaxed);
+        } else if(ring->write_pos.compare_exchange_weak(pos, pos | LOCKED, std::memory_order_relaxed)) {
+            return ring;
+        }
+    }
+}
+
+void AsyncPrinter::unlock_ring(Ring* ring) {
+    ring->write_pos.fetch_and(~LOCKED, std::memory_order_relaxed);
+}
+
+// Pushes a record without payload, which is never dropped. Returns the ring it went into and its position.
+uint64_t AsyncPrinter::push_control(uint32_t kind, Ring** ring) {
+    uint64_t position = 0;
+    char* payload = reserve(0, kind, ring, &position, false);
+    publish(payload, position);
+    return position;
+}
+
+void AsyncPrinter::write_records() {
+    // Batch records up, so the sink gets few big prints
+    BufferedPrinter buffered(_sink, BufferedPrinter::FlushPolicy::FULL, BufferedPrinter::DEFAULT_CAP, _allocator);
+    Ring* ring = _first_ring;
+    uint32_t num_idle_polls = 0;
+    for(;;) {
+        uint64_t pos = ring->read_pos.load(std::memory_order_relaxed);
+        RecordHeader* header = ring->header_at(pos);
+        if(std::atomic_ref<uint64_t>(header->sequence).load(std::memory_order_acquire) != pos + 1) {
+            Ring* next = ring->next.load(std::memory_order_acquire);
+            uint64_t write_pos = ring->write_pos.load(std::memory_order_relaxed) & ~POSITION_FLAGS;
+            if(next && pos == write_pos) {
+                ring = next;
+            } else if(pos != write_pos) {
+                // The record is being written
+                std::this_thread::yield();
+            } else if(num_idle_polls < MAX_IDLE_POLLS) {
+                // More records tend to follow soon, e.g. from threads waiting for room in the ring
+                if(!num_idle_polls++) {
+                    buffered.sync();
+                }
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            continue;
+        }
+        num_idle_polls = 0;
+
+        uint32_t kind = header->kind;
+        if(kind == TEXT) {
+            buffered.print(StringSlice((char*)(header + 1), header->payload_size));
+        } else if(kind == FLUSH || kind == STOP) {
+            buffered.sync();
+        }
+        size_t size = record_size(header->payload_size);
+        for(size_t offset = 0; offset < size; offset += RECORD_ALIGNMENT) {
+            std::atomic_ref<uint64_t>(ring->header_at(pos + offset)->sequence).store(0, std::memory_order_relaxed);
+        }
+        ring->read_pos.store(pos + size, std::memory_order_release);
+        if(kind == FLUSH) {
+            // Only flushes wake up threads waiting on the read position, so that other records don't pay for it
+            ring->read_pos.notify_all();
+        } else if(kind == STOP) {
+            return;
+        }
+    }
+}
+
+void AsyncPrinter::print(StringSlice string) {
+    if(!string.size()) return;
+    if(_policy == FullPolicy::BLOCK) {
+        size_t max_size = _ring.load(std::memory_order_relaxed)->max_record_size() - sizeof(RecordHeader);
+        if(string.size() > max_size) {
+            // Split it into consecutive records, with the ring locked so that no other records get in between
+            Ring* locked = lock_ring();
+            while(string.size()) {
+                StringSlice piece = string[Range(0, string.size() < max_size ? string.size() : max_size)];
+                Ring* ring;
+                uint64_t position;
+                char* payload = reserve(piece.size(), TEXT, &ring, &position, true);
+                memcpy(payload, piece.data(), piece.size());
+                publish(payload, position);
+                string = string[Range(piece.size(), string.size())];
+            }
+            unlock_ring(locked);
+            return;
+        }
+    }
+
+    Ring* ring;
+    uint64_t position;
+    char* payload = reserve(string.size(), TEXT, &ring, &position, false);
+    if(!payload) return;
+    memcpy(payload, string.data(), string.size());
+    publish(payload, position);
+}
+
+void AsyncPrinter::print(WideStringSlice string) {
+    if(!string.size()) return;
+    size_t size = wide_to_utf8_length(string.data(), string.size());
+    if(_policy == FullPolicy::BLOCK && size > _ring.load(std::memory_order_relaxed)->max_record_size() - sizeof(RecordHeader)) {
+        // Let the narrow overload split it up
+        String narrow;
+        narrow.append(string);
+        print(narrow.as_slice());
+        return;
+    }
+
+    Ring* ring;
+    uint64_t position;
+    char* payload = reserve(size, TEXT, &ring, &position, false);
+    if(!payload) return;
+    wide_to_utf8(string.data(), string.size(), payload);
+    publish(payload, position);
+}
+
+void AsyncPrinter::flush() {
+    Ring* ring;
+    uint64_t position = push_control(FLUSH, &ring);
+    uint64_t read_pos = ring->read_pos.load(std::memory_order_acquire);
+    while(read_pos <= position) {
+        ring->read_pos.wait(read_pos, std::memory_order_acquire);
+        read_pos = ring->read_pos.load(std::memory_order_acquire);
+    }
+}
+
+void AsyncPrinter::sync() {
+    flush();
+}
+
+void AsyncPrinter::shutdown() {
+    if(!_is_running) return;
+    Ring* ring;
+    push_control(STOP, &ring);
+    _writer.join();
+    _is_running = false;
+}
+
+uint64_t AsyncPrinter::num_dropped() const {
+    return _num_dropped.load(std::memory_order_relaxed);
+}
+
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "alloc.h"
+#include "fmt.h"
+
+namespace zw {
+
+/// Printer that hands its output to a background thread, which passes it on to a sink printer, so that the
+/// threads printing never wait for I/O.
+///
+/// Each print is copied as one record into a ring buffer that any number of threads can write to without
+/// locking: a thread reserves room for its record by advancing the shared write position with a CAS, copies
+/// the text in, and publishes it by storing the record's position in its header. The writer thread takes
+/// records in order, waiting for ones that are reserved but not yet published, and batches them into a
+/// BufferedPrinter in front of the sink. When there is nothing to write, it polls for a while and then sleeps
+/// a millisecond between checks, rather than making every print wake it up.
+///
+/// Separate prints from different threads can end up interleaved, so to keep lines whole, give every thread
+/// a BufferedPrinter with FlushPolicy::LINE in front of the shared AsyncPrinter. That also means one record
+/// per line instead of one per fragment. Each print comes out whole: under FullPolicy::BLOCK, one that's too
+/// big for a single record goes in as several with nothing from other threads between them. Under
+/// FullPolicy::DROP, it's dropped, and under FullPolicy::GROW, the ring grows to fit it.
+///
+/// The sink is only ever used from the writer thread, so it doesn't need to be thread-safe, but it must not
+/// be printed to directly while the AsyncPrinter is running.
+class AsyncPrinter: public Printer {
+public:
+    /// What print does when the ring buffer doesn't have room for a record.
+    enum class FullPolicy {
+        /// Wait for the writer thread to make room. Prints bigger than half the ring are split up into
+        /// consecutive records, and other threads wait until they're all in, so the print still comes out whole.
+        BLOCK,
+        /// Throw the record away, counting it in num_dropped().
+        DROP,
+        /// Switch to a ring twice the size (or more, to fit the record). The old ring stays allocated until
+        /// the printer is destroyed, since other threads may still be looking at it.
+        GROW,
+    };
+
+    static constexpr size_t DEFAULT_CAP = 1024 * 1024;
+
+private:
+    struct Ring;
+
+    Printer* _sink;
+    Allocator* _allocator;
+    FullPolicy _policy;
+    std::atomic<Ring*> _ring;
+    // Every ring ever allocated, linked through Ring::next in the order they were switched to
+    Ring* _first_ring;
+    std::mutex _grow_lock;
+    std::atomic<uint64_t> _num_dropped {0};
+    std::thread _writer;
+    bool _is_running;
+
+    char* reserve(size_t payload_size, uint32_t kind, Ring** reserved_ring, uint64_t* position, bool has_lock);
+    void publish(char* payload, uint64_t position);
+    Ring* lock_ring();
+    void unlock_ring(Ring* ring);
+    uint64_t push_control(uint32_t kind, Ring** ring);
+    void write_records();
+
+public:
+    explicit AsyncPrinter(Printer* sink, FullPolicy policy = FullPolicy::BLOCK, size_t cap = DEFAULT_CAP, Allocator* allocator = zw_get_ctx(allocator));
+    AsyncPrinter(const AsyncPrinter& other) = delete;
+    AsyncPrinter(AsyncPrinter&& other) = delete;
+    /// Calls shutdown() if it hasn't been called yet.
+    ~AsyncPrinter();
+
+    void print(StringSlice string) override;
+    /// Wide strings are converted to UTF-8.
+    void print(WideStringSlice string) override;
+
+    /// Waits until everything that was printed before the call has been passed on to the sink, and the
+    /// sink has been synced.
+    void flush();
+    void sync() override;
+
+    /// Flushes, then stops the writer thread. Nothing may be printed afterwards.
+    void shutdown();
+
+    /// Number of records thrown away under FullPolicy::DROP.
+    uint64_t num_dropped() const;
+};
+
+};
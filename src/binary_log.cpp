@@ -0,0 +1,239 @@
+#include <assert.h>
+
+#include "binary_log.h"
+
+ZW_DEFINE_CTX_VAR(zw::BinaryLog*, binary_log, nullptr);
+
+namespace zw {
+
+constexpr char SERIALIZED_MAGIC[4] = {'Z', 'W', 'B', 'L'};
+constexpr uint8_t SERIALIZED_VERSION = 1;
+// Reads back as something else on a machine with the other byte order
+constexpr uint16_t BYTE_ORDER_MARK = 0x0102;
+
+// serialize() writes this header, then the format table, then the records
+struct SerializedHeader {
+    char magic[4];
+    uint16_t byte_order;
+    uint8_t version;
+    uint8_t wchar_size;
+    uint64_t num_formats;
+    uint64_t formats_size;
+    uint64_t records_size;
+};
+static_assert(sizeof(SerializedHeader) % impl::DEFERRED_ALIGNMENT == 0);
+
+// Each entry of the format table is one of these, followed by the format's characters and a tag for each
+// argument, padded to DEFERRED_ALIGNMENT
+struct SerializedFormat {
+    uint32_t format_size;
+    uint32_t num_args;
+};
+
+// A format table entry once it has been checked and parsed for decoding
+struct DecodedFormat {
+    StringSlice format;
+    const uint8_t* tags;
+    uint32_t num_args;
+    // Index of the format's first literal in the decoder's literals
+    size_t first_literal;
+};
+
+template<typename T>
+static T read_unaligned(const uint8_t* in) {
+    T value;
+    memcpy(&value, in, sizeof(T));
+    return value;
+}
+
+static void append_bytes(Array<uint8_t>* out, const void* data, size_t size) {
+    if(!size) return;
+    size_t old_size = out->size();
+    out->reserve(old_size + size);
+    memcpy(out->data() + old_size, data, size);
+    out->unsafe_set_size(old_size + size);
+}
+
+// Size of the argument with the given tag at in, or SIZE_MAX if it doesn't fit in available bytes.
+static size_t deferred_arg_size(uint8_t tag, const uint8_t* in, size_t available) {
+    size_t size;
+    if(tag == impl::DEFERRED_STRING || tag == impl::DEFERRED_WIDE_STRING) {
+        if(available < sizeof(uint64_t)) return SIZE_MAX;
+        size_t char_size = tag == impl::DEFERRED_STRING ? sizeof(char) : sizeof(wchar_t);
+        uint64_t length = read_unaligned<uint64_t>(in);
+        if(length > (available - sizeof(uint64_t)) / char_size) return SIZE_MAX;
+        size = sizeof(uint64_t) + impl::deferred_aligned(length * char_size);
+    } else {
+        // Everything else fits in one aligned unit
+        size = impl::DEFERRED_ALIGNMENT;
+    }
+    return size <= available ? size : SIZE_MAX;
+}
+
+static void display_deferred_arg(uint8_t tag, const uint8_t* in) {
+    switch(tag) {
+        case impl::DEFERRED_BOOL: zw_display(read_unaligned<uint8_t>(in) != 0); break;
+        case impl::DEFERRED_I8: zw_display(read_unaligned<int8_t>(in)); break;
+        case impl::DEFERRED_I16: zw_display(read_unaligned<int16_t>(in)); break;
+        case impl::DEFERRED_I32: zw_display(read_unaligned<int32_t>(in)); break;
+        case impl::DEFERRED_I64: zw_display(read_unaligned<int64_t>(in)); break;
+        case impl::DEFERRED_U8: zw_display(read_unaligned<uint8_t>(in)); break;
+        case impl::DEFERRED_U16: zw_display(read_unaligned<uint16_t>(in)); break;
+        case impl::DEFERRED_U32: zw_display(read_unaligned<uint32_t>(in)); break;
+        case impl::DEFERRED_U64: zw_display(read_unaligned<uint64_t>(in)); break;
+        case impl::DEFERRED_F32: zw_display(read_unaligned<float>(in)); break;
+        case impl::DEFERRED_F64: zw_display(read_unaligned<double>(in)); break;
+        case impl::DEFERRED_STRING: {
+            zw_display(StringSlice((const char*)(in + sizeof(uint64_t)), read_unaligned<uint64_t>(in)));
+            break;
+        }
+        case impl::DEFERRED_WIDE_STRING: {
+            // Copied out, since a buffer from serialize() may have been loaded anywhere
+            WideString string;
+            string.resize(read_unaligned<uint64_t>(in));
+            memcpy(string.data(), in + sizeof(uint64_t), string.size() * sizeof(wchar_t));
+            zw_display(string.as_slice());
+            break;
+        }
+        case impl::DEFERRED_HEX: zw_display(Hex(read_unaligned<uint64_t>(in))); break;
+        case impl::DEFERRED_BINARY: zw_display(Binary(read_unaligned<uint64_t>(in))); break;
+    }
+}
+
+static void print_format_literal(StringSlice format, const impl::FormatLiteral& literal) {
+    StringSlice text = format[Range(literal.begin, literal.end)];
+    if(!text.size()) return;
+    if(literal.num_escapes) {
+        impl::print_unescaped(zw_get_ctx(printer), text);
+    } else {
+        zw_get_ctx(printer)->print(text);
+    }
+}
+
+// Prints the records, whose formats are in the table of num_formats entries. Everything is checked first, so
+// that bad input is reported instead of read out of bounds.
+static bool decode_records(const uint8_t* formats, size_t formats_size, uint64_t num_formats, const uint8_t* records, size_t records_size) {
+    Array<DecodedFormat> decoded;
+    Array<impl::FormatLiteral> literals;
+    size_t offset = 0;
+    for(uint64_t i = 0; i < num_formats; i++) {
+        if(formats_size - offset < sizeof(SerializedFormat)) return false;
+        SerializedFormat entry = read_unaligned<SerializedFormat>(formats + offset);
+        size_t entry_size = sizeof(SerializedFormat) + (size_t)entry.format_size + entry.num_args;
+        if(formats_size - offset < entry_size) return false;
+
+        DecodedFormat format;
+        format.format = StringSlice((const char*)(formats + offset + sizeof(SerializedFormat)), entry.format_size);
+        format.tags = formats + offset + sizeof(SerializedFormat) + entry.format_size;
+        format.num_args = entry.num_args;
+        format.first_literal = literals.size();
+        for(uint32_t arg = 0; arg < entry.num_args; arg++) {
+            if(format.tags[arg] >= impl::NUM_DEFERRED_TAGS) return false;
+        }
+        literals.resize(literals.size() + entry.num_args + 1);
+        if(impl::parse_format_string(format.format, &literals[format.first_literal], entry.num_args) != impl::FormatStringError::NONE) {
+            return false;
+        }
+        decoded.push(format);
+        offset += impl::deferred_aligned(entry_size);
+        if(offset > formats_size) return false;
+    }
+
+    offset = 0;
+    while(offset != records_size) {
+        if(records_size - offset < sizeof(impl::BinaryLogRecord)) return false;
+        impl::BinaryLogRecord record = read_unaligned<impl::BinaryLogRecord>(records + offset);
+        offset += sizeof(record);
+        if(record.format_id >= decoded.size() || records_size - offset < record.args_size) return false;
+
+        const DecodedFormat& format = decoded[record.format_id];
+        const uint8_t* args = records + offset;
+        size_t args_used = 0;
+        for(uint32_t arg = 0; arg < format.num_args; arg++) {
+            size_t size = deferred_arg_size(format.tags[arg], args + args_used, record.args_size - args_used);
+            if(size == SIZE_MAX) return false;
+            args_used += size;
+        }
+        if(args_used != record.args_size) return false;
+
+        args_used = 0;
+        for(uint32_t arg = 0; arg < format.num_args; arg++) {
+            print_format_literal(format.format, literals[format.first_literal + arg]);
+            display_deferred_arg(format.tags[arg], args + args_used);
+            args_used += deferred_arg_size(format.tags[arg], args + args_used, record.args_size - args_used);
+        }
+        print_format_literal(format.format, literals[format.first_literal + format.num_args]);
+        zw_print("\n");
+        offset += record.args_size;
+    }
+    return true;
+}
+
+BinaryLog::BinaryLog(size_t cap, Allocator* allocator) : _allocator(allocator), _size(0), _cap(cap), _num_dropped(0), _num_formats(0) {
+    _data = (uint8_t*)zw_alloc(_allocator, _cap, impl::DEFERRED_ALIGNMENT);
+    assert(_data && "allocator out of memory");
+}
+
+BinaryLog::~BinaryLog() {
+    zw_free(_allocator, _data);
+    // The format table grew through the context allocator, so it has to match on the way out too
+    zw_set_ctx(allocator, _allocator);
+    Array<uint8_t> formats = std::move(_formats);
+    HashMap<impl::FormatKey, uint32_t> format_ids = std::move(_format_ids);
+}
+
+uint32_t BinaryLog::add_format(StringSlice format, const uint8_t* tags, size_t num_args) {
+    zw_set_ctx(allocator, _allocator);
+    uint32_t id = _num_formats++;
+    SerializedFormat entry = {(uint32_t)format.size(), (uint32_t)num_args};
+    append_bytes(&_formats, &entry, sizeof(entry));
+    append_bytes(&_formats, format.data(), format.size());
+    append_bytes(&_formats, tags, num_args);
+    _formats.resize(impl::deferred_aligned(_formats.size()));
+    _format_ids.insert(impl::FormatKey { format.data(), tags }, id);
+    return id;
+}
+
+void BinaryLog::decode() const {
+    [[maybe_unused]] bool is_valid = decode_records(_formats.data(), _formats.size(), _num_formats, _data, _size);
+    assert(is_valid);
+}
+
+void BinaryLog::clear() {
+    _size = 0;
+    _num_dropped = 0;
+}
+
+Array<uint8_t> BinaryLog::serialize() const {
+    SerializedHeader header = {};
+    memcpy(header.magic, SERIALIZED_MAGIC, sizeof(header.magic));
+    header.byte_order = BYTE_ORDER_MARK;
+    header.version = SERIALIZED_VERSION;
+    header.wchar_size = sizeof(wchar_t);
+    header.num_formats = _num_formats;
+    header.formats_size = _formats.size();
+    header.records_size = _size;
+
+    Array<uint8_t> out;
+    out.reserve(sizeof(header) + _formats.size() + _size);
+    append_bytes(&out, &header, sizeof(header));
+    append_bytes(&out, _formats.data(), _formats.size());
+    append_bytes(&out, _data, _size);
+    return out;
+}
+
+bool BinaryLog::decode_serialized(const uint8_t* data, size_t size) {
+    if(size < sizeof(SerializedHeader)) return false;
+    SerializedHeader header = read_unaligned<SerializedHeader>(data);
+    if(memcmp(header.magic, SERIALIZED_MAGIC, sizeof(header.magic)) != 0 || header.byte_order != BYTE_ORDER_MARK ||
+        header.version != SERIALIZED_VERSION || header.wchar_size != sizeof(wchar_t)) {
+        return false;
+    }
+    size_t body_size = size - sizeof(SerializedHeader);
+    if(header.formats_size > body_size || header.records_size != body_size - header.formats_size) return false;
+
+    const uint8_t* formats = data + sizeof(SerializedHeader);
+    return decode_records(formats, header.formats_size, header.num_formats, formats + header.formats_size, header.records_size);
+}
+
+};
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <bit>
+#include <concepts>
+#include <type_traits>
+
+#include "alloc.h"
+#include "array.h"
+#include "context.h"
+#include "fmt.h"
+#include "hash_map.h"
+
+// Deferred logging for trace points too hot to format text at. zw_log_binary() takes the same format string
+// literals and arguments as zw_println(), but only appends a record to the thread's BinaryLog: the ID of the
+// format, followed by the arguments' bytes. Strings are copied, as their length and their characters; integers,
+// floating point numbers, bools, Hex and Binary are copied as is. Every argument is padded to a multiple of eight
+// bytes so that everything stays aligned.
+//
+// The first record with a given format string and argument types adds it to the log's format table, which holds
+// the text of the format and a tag for the type of each argument. Nothing is formatted until decoding, which
+// rebuilds the arguments from their tags and prints them with their usual zw_display overloads. That only takes
+// the bytes of the log, so serialize() can save them to be decoded by another process, such as a log viewer.
+
+namespace zw { class BinaryLog; };
+
+ZW_DECLARE_CTX_VAR(zw::BinaryLog*, binary_log);
+
+namespace zw {
+
+namespace impl {
+    template<typename T>
+    concept DeferredString = std::convertible_to<const T&, StringSlice>;
+    template<typename T>
+    concept DeferredWideString = std::convertible_to<const T&, WideStringSlice>;
+
+    template<typename T>
+    concept DeferredArgument = DeferredString<T> || DeferredWideString<T> || std::integral<T> || std::same_as<T, float> ||
+        std::same_as<T, double> || std::same_as<T, Hex> || std::same_as<T, Binary>;
+
+    // The type of an argument, as stored in the format table. Integers are decoded as the integer type of the same
+    // size and signedness, which zw_display() shows the same way.
+    enum DeferredTag: uint8_t {
+        DEFERRED_BOOL,
+        DEFERRED_I8,
+        DEFERRED_I16,
+        DEFERRED_I32,
+        DEFERRED_I64,
+        DEFERRED_U8,
+        DEFERRED_U16,
+        DEFERRED_U32,
+        DEFERRED_U64,
+        DEFERRED_F32,
+        DEFERRED_F64,
+        DEFERRED_STRING,
+        DEFERRED_WIDE_STRING,
+        DEFERRED_HEX,
+        DEFERRED_BINARY,
+        NUM_DEFERRED_TAGS,
+    };
+
+    template<DeferredArgument T>
+    constexpr DeferredTag deferred_tag() {
+        if constexpr(DeferredString<T>) {
+            return DEFERRED_STRING;
+        } else if constexpr(DeferredWideString<T>) {
+            return DEFERRED_WIDE_STRING;
+        } else if constexpr(std::same_as<T, bool>) {
+            return DEFERRED_BOOL;
+        } else if constexpr(std::integral<T>) {
+            return (DeferredTag)((std::is_signed_v<T> ? DEFERRED_I8 : DEFERRED_U8) + std::bit_width(sizeof(T)) - 1);
+        } else if constexpr(std::same_as<T, float>) {
+            return DEFERRED_F32;
+        } else if constexpr(std::same_as<T, double>) {
+            return DEFERRED_F64;
+        } else if constexpr(std::same_as<T, Hex>) {
+            return DEFERRED_HEX;
+        } else {
+            return DEFERRED_BINARY;
+        }
+    }
+
+    // One array per list of argument types, whose address identifies the list
+    template<typename... Ds>
+    struct DeferredTags {
+        static constexpr uint8_t TAGS[sizeof...(Ds) + 1] = {deferred_tag<Ds>()..., NUM_DEFERRED_TAGS};
+    };
+
+    constexpr size_t DEFERRED_ALIGNMENT = 8;
+
+    constexpr size_t deferred_aligned(size_t size) {
+        return (size + DEFERRED_ALIGNMENT - 1) & ~(DEFERRED_ALIGNMENT - 1);
+    }
+
+    // Strings are stored as their length in a uint64_t, followed by their characters
+    template<typename T>
+    size_t deferred_size(const T& value) {
+        if constexpr(DeferredString<T>) {
+            return sizeof(uint64_t) + deferred_aligned(StringSlice(value).size());
+        } else if constexpr(DeferredWideString<T>) {
+            return sizeof(uint64_t) + deferred_aligned(WideStringSlice(value).size() * sizeof(wchar_t));
+        } else {
+            return deferred_aligned(sizeof(T));
+        }
+    }
+
+    template<typename Char>
+    uint8_t* write_deferred_string(uint8_t* out, GenericStringSlice<Char> string) {
+        uint64_t size = string.size();
+        memcpy(out, &size, sizeof(size));
+        memcpy(out + sizeof(size), string.data(), string.size() * sizeof(Char));
+        return out + sizeof(size) + deferred_aligned(string.size() * sizeof(Char));
+    }
+
+    template<typename T>
+    uint8_t* write_deferred(uint8_t* out, const T& value) {
+        if constexpr(DeferredString<T>) {
+            return write_deferred_string(out, StringSlice(value));
+        } else if constexpr(DeferredWideString<T>) {
+            return write_deferred_string(out, WideStringSlice(value));
+        } else {
+            memcpy(out, &value, sizeof(T));
+            return out + deferred_aligned(sizeof(T));
+        }
+    }
+
+    struct BinaryLogRecord {
+        uint32_t format_id;
+        uint32_t args_size;
+    };
+    static_assert(sizeof(BinaryLogRecord) % DEFERRED_ALIGNMENT == 0);
+
+    // What the format table is looked up by when logging. Both point to constants, so they stay the same for
+    // every record from a call site.
+    struct FormatKey {
+        const char* format;
+        const uint8_t* tags;
+
+        bool operator==(const FormatKey& other) const = default;
+    };
+};
+
+/// A format string that is a literal. Formats are looked up by address, so runtime_format() strings, whose
+/// memory could later hold a different format, aren't accepted.
+template<size_t NUM_ARGS>
+class LiteralFormatString {
+    FormatString<NUM_ARGS> _format;
+public:
+    consteval LiteralFormatString(const char* string) : _format(string) {}
+
+    StringSlice string() const { return _format.string(); }
+};
+
+/// Per-thread buffer of zw_log_binary() records. Install one with zw_set_ctx(binary_log, ...) on each thread
+/// that logs. Records that don't fit are dropped and counted.
+class BinaryLog {
+    Allocator* _allocator;
+    uint8_t* _data;
+    size_t _size;
+    size_t _cap;
+    uint64_t _num_dropped;
+    // The format table, laid out as it is in serialize()'s output
+    Array<uint8_t> _formats;
+    uint32_t _num_formats;
+    HashMap<impl::FormatKey, uint32_t> _format_ids;
+
+    uint32_t add_format(StringSlice format, const uint8_t* tags, size_t num_args);
+
+    uint32_t format_id(StringSlice format, const uint8_t* tags, size_t num_args) {
+        if(Option<uint32_t*> id = _format_ids.get(impl::FormatKey { format.data(), tags }); id.is_present()) {
+            return *id.unwrap();
+        }
+        return add_format(format, tags, num_args);
+    }
+
+public:
+    static constexpr size_t DEFAULT_CAP = 1024 * 1024;
+
+    explicit BinaryLog(size_t cap = DEFAULT_CAP, Allocator* allocator = zw_get_ctx(allocator));
+    BinaryLog(const BinaryLog& other) = delete;
+    BinaryLog(BinaryLog&& other) = delete;
+    ~BinaryLog();
+
+    template<typename... Ds>
+    void log(LiteralFormatString<sizeof...(Ds)> format, const Ds&... ds) {
+        static_assert((impl::DeferredArgument<std::decay_t<Ds>> && ... && true), "zw_log_binary() arguments must be strings, integers, floating point numbers, bools, Hex or Binary");
+        size_t args_size = (impl::deferred_size(ds) + ... + 0);
+        size_t size = sizeof(impl::BinaryLogRecord) + args_size;
+        if(size > _cap - _size) {
+            _num_dropped++;
+            return;
+        }
+        // Records are always aligned
+        impl::BinaryLogRecord* record = (impl::BinaryLogRecord*)(_data + _size);
+        record->format_id = format_id(format.string(), impl::DeferredTags<std::decay_t<Ds>...>::TAGS, sizeof...(Ds));
+        record->args_size = (uint32_t)args_size;
+        [[maybe_unused]] uint8_t* out = (uint8_t*)(record + 1);
+        ((out = impl::write_deferred(out, ds)), ...);
+        _size += size;
+    }
+
+    /// Prints every record through the context printer, each on its own line, as zw_println() would have.
+    void decode() const;
+    /// Removes all records. Formats stay in the format table.
+    void clear();
+
+    /// The format table and the records, in one buffer that decode_serialized() can print from in any process
+    /// on a machine with the same byte order and wchar_t size.
+    Array<uint8_t> serialize() const;
+    /// Prints the records of a buffer made by serialize() like decode() does. Returns false, having printed the
+    /// records before the problem, if the buffer isn't a whole, valid serialized log.
+    static bool decode_serialized(const uint8_t* data, size_t size);
+
+    /// Bytes of records logged.
+    size_t size() const { return _size; }
+    uint64_t num_dropped() const { return _num_dropped; }
+};
+
+};
+
+/// Like zw_println(), except that formatting is deferred to BinaryLog::decode(). Does nothing if there is no
+/// context binary log.
+template<typename... Ds>
+void zw_log_binary(zw::LiteralFormatString<sizeof...(Ds)> format, const Ds&... ds) {
+    zw::BinaryLog* log = zw_get_ctx(binary_log);
+    if(log) {
+        log->log(format, ds...);
+    }
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <bit>
+
+#include "macros.h"
+#include "array.h"
+#include "iter.h"
+#include "option.h"
+
+#ifdef ZW_AVX2
+#include <immintrin.h>
+#endif
+
+namespace zw {
+
+namespace impl {
+
+#ifdef ZW_AVX2
+// Counts the bits of 4 words at a time by looking up each nibble's popcount with a shuffle, then summing
+// the byte counts with SAD against zero.
+inline uint64_t popcount_words(const uint64_t* words, size_t count) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0F);
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(words + i));
+        __m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low_mask));
+        __m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+    }
+    uint64_t result = (uint64_t)_mm256_extract_epi64(total, 0) + (uint64_t)_mm256_extract_epi64(total, 1) +
+                      (uint64_t)_mm256_extract_epi64(total, 2) + (uint64_t)_mm256_extract_epi64(total, 3);
+    for(; i < count; i++) {
+        result += std::popcount(words[i]);
+    }
+    return result;
+}
+#else
+inline uint64_t popcount_words(const uint64_t* words, size_t count) {
+    // Independent accumulators, so that consecutive popcnts don't wait on each other
+    uint64_t a = 0, b = 0, c = 0, d = 0;
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        a += std::popcount(words[i]);
+        b += std::popcount(words[i + 1]);
+        c += std::popcount(words[i + 2]);
+        d += std::popcount(words[i + 3]);
+    }
+    for(; i < count; i++) {
+        a += std::popcount(words[i]);
+    }
+    return a + b + c + d;
+}
+#endif
+
+// Index of the nth (0-based) set bit of word, which must have more than n bits set.
+inline size_t select_in_word(uint64_t word, size_t n) {
+    for(size_t i = 0; i < n; i++) {
+        word &= word - 1;
+    }
+    return std::countr_zero(word);
+}
+
+};
+
+class SetBitsIterator {
+    const uint64_t* words;
+    size_t num_words;
+    size_t word_index;
+    uint64_t word;
+
+    void skip_empty_words() {
+        while(!word && ++word_index < num_words) {
+            word = words[word_index];
+        }
+    }
+public:
+    using Element = size_t;
+
+    SetBitsIterator(const uint64_t* words, size_t num_words, size_t word_index) : words(words), num_words(num_words), word_index(word_index) {
+        word = 0;
+        if(word_index < num_words) {
+            word = words[word_index];
+            skip_empty_words();
+        }
+    }
+
+    SetBitsIterator& operator++() {
+        word &= word - 1;
+        skip_empty_words();
+        return *this;
+    }
+
+    bool operator==(const SetBitsIterator& other) const { return word_index == other.word_index && word == other.word; }
+    bool operator!=(const SetBitsIterator& other) const { return !(*this == other); }
+    size_t operator*() { return word_index * 64 + std::countr_zero(word); }
+};
+
+class SetBitsIterable: public Iterable<SetBitsIterable> {
+    const uint64_t* words;
+    size_t num_words;
+public:
+    using Iterator = SetBitsIterator;
+
+    SetBitsIterable(const uint64_t* words, size_t num_words) : words(words), num_words(num_words) {}
+    Iterator begin() const { return Iterator(words, num_words, 0); }
+    Iterator end() const { return Iterator(words, num_words, num_words); }
+};
+
+/// Fixed-size set of bits packed into 64-bit words from the context allocator. Bits past size() in the last
+/// word are always kept clear, so whole-word operations never have to mask them.
+class BitArray {
+    constexpr static size_t WORDS_PER_RANK_BLOCK = 8;
+
+    Array<uint64_t> _words;
+    size_t _size = 0;
+
+    // Number of set bits before each block of WORDS_PER_RANK_BLOCK words, built by build_rank_index().
+    Array<uint64_t> _block_ranks;
+    bool _rank_index_valid = false;
+
+    static size_t num_words_for(size_t num_bits) { return (num_bits + 63) / 64; }
+
+    void clear_tail() {
+        if(_size % 64) {
+            _words.last() &= ((uint64_t)1 << (_size % 64)) - 1;
+        }
+    }
+
+    template<typename F>
+    void combine(const BitArray& other, F op) {
+        assert(other._size == _size);
+        uint64_t* words = _words.data();
+        const uint64_t* other_words = other._words.data();
+        // Plain word loop; compilers turn this into full-width vector code.
+        for(size_t i = 0; i < _words.size(); i++) {
+            words[i] = op(words[i], other_words[i]);
+        }
+        _rank_index_valid = false;
+    }
+
+public:
+    BitArray() = default;
+    explicit BitArray(size_t num_bits) {
+        resize(num_bits);
+    }
+
+    size_t size() const { return _size; }
+    size_t num_words() const { return _words.size(); }
+    const uint64_t* words() const { return _words.data(); }
+
+    /// New bits are cleared.
+    void resize(size_t num_bits) {
+        _size = num_bits;
+        _words.resize(num_words_for(num_bits));
+        clear_tail();
+        _rank_index_valid = false;
+    }
+
+    bool test(size_t index) const {
+        assert(index < _size);
+        return (_words[index / 64] >> (index % 64)) & 1;
+    }
+    void set(size_t index) {
+        assert(index < _size);
+        _words[index / 64] |= (uint64_t)1 << (index % 64);
+        _rank_index_valid = false;
+    }
+    void clear(size_t index) {
+        assert(index < _size);
+        _words[index / 64] &= ~((uint64_t)1 << (index % 64));
+        _rank_index_valid = false;
+    }
+    void assign(size_t index, bool value) {
+        if(value) {
+            set(index);
+        } else {
+            clear(index);
+        }
+    }
+
+    void set_all() {
+        memset(_words.data(), 0xFF, _words.size() * sizeof(uint64_t));
+        clear_tail();
+        _rank_index_valid = false;
+    }
+    void clear_all() {
+        memset(_words.data(), 0, _words.size() * sizeof(uint64_t));
+        _rank_index_valid = false;
+    }
+
+    // In-place set operations between bit arrays of the same size
+    void and_with(const BitArray& other) { combine(other, [](uint64_t a, uint64_t b) { return a & b; }); }
+    void or_with(const BitArray& other) { combine(other, [](uint64_t a, uint64_t b) { return a | b; }); }
+    void xor_with(const BitArray& other) { combine(other, [](uint64_t a, uint64_t b) { return a ^ b; }); }
+    /// Clears every bit that is set in other.
+    void and_not_with(const BitArray& other) { combine(other, [](uint64_t a, uint64_t b) { return a & ~b; }); }
+    void invert() {
+        for(auto& word: _words.iter_mut()) {
+            word = ~word;
+        }
+        clear_tail();
+        _rank_index_valid = false;
+    }
+
+    /// Number of set bits.
+    size_t count_ones() const { return impl::popcount_words(_words.data(), _words.size()); }
+
+    bool any() const {
+        for(uint64_t word: _words.iter()) {
+            if(word) return true;
+        }
+        return false;
+    }
+
+    /// Index of the first set bit at or after from, if any.
+    Option<size_t> find_first_set(size_t from = 0) const {
+        if(from >= _size) return {};
+
+        size_t word_index = from / 64;
+        uint64_t word = _words[word_index] & (~(uint64_t)0 << (from % 64));
+        for(;;) {
+            if(word) {
+                return word_index * 64 + std::countr_zero(word);
+            }
+            if(++word_index == _words.size()) return {};
+            word = _words[word_index];
+        }
+    }
+
+    /// Iterates over the indices of the set bits in increasing order.
+    SetBitsIterable iter_ones() const { return {_words.data(), _words.size()}; }
+
+    /// Builds the index that makes rank() O(1) and select() O(log n). It is dropped by any modification.
+    void build_rank_index() {
+        size_t num_blocks = (_words.size() + WORDS_PER_RANK_BLOCK - 1) / WORDS_PER_RANK_BLOCK;
+        _block_ranks.resize(num_blocks);
+        uint64_t total = 0;
+        for(size_t block = 0; block < num_blocks; block++) {
+            _block_ranks[block] = total;
+            size_t first_word = block * WORDS_PER_RANK_BLOCK;
+            size_t count = impl::min(WORDS_PER_RANK_BLOCK, _words.size() - first_word);
+            total += impl::popcount_words(_words.data() + first_word, count);
+        }
+        _rank_index_valid = true;
+    }
+
+    /// Number of set bits before index.
+    size_t rank(size_t index) const {
+        assert(index <= _size);
+        size_t word_index = index / 64;
+        size_t first_word = 0;
+        size_t result = 0;
+        if(_rank_index_valid) {
+            size_t block = word_index / WORDS_PER_RANK_BLOCK;
+            if(block < _block_ranks.size()) {
+                first_word = block * WORDS_PER_RANK_BLOCK;
+                result = _block_ranks[block];
+            }
+        }
+        result += impl::popcount_words(_words.data() + first_word, word_index - first_word);
+        if(index % 64) {
+            result += std::popcount(_words[word_index] & (((uint64_t)1 << (index % 64)) - 1));
+        }
+        return result;
+    }
+
+    /// Index of the nth (0-based) set bit, if there are that many.
+    Option<size_t> select(size_t n) const {
+        size_t word_index = 0;
+        if(_rank_index_valid && _block_ranks.size()) {
+            // Last block whose starting rank is <= n
+            Option<size_t> upper = _block_ranks.upper_bound(n);
+            size_t block = (upper.is_present() ? upper.unwrap() : _block_ranks.size()) - 1;
+            word_index = block * WORDS_PER_RANK_BLOCK;
+            n -= _block_ranks[block];
+        }
+        for(; word_index < _words.size(); word_index++) {
+            size_t ones = std::popcount(_words[word_index]);
+            if(n < ones) {
+                return word_index * 64 + impl::select_in_word(_words[word_index], n);
+            }
+            n -= ones;
+        }
+        return {};
+    }
+};
+
+};
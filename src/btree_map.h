@@ -0,0 +1,683 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+
+#include "alloc.h"
+#include "iter.h"
+#include "misc.h"
+#include "option.h"
+#include "range.h"
+#include "sort.h"
+
+namespace zw {
+
+namespace impl {
+
+// Hands out fixed-size blocks carved from chunks of the context allocator, recycling freed blocks through an
+// intrusive free list. Chunks are only given back when the pool is released, all at once.
+template<size_t BlockSize, size_t BlockAlignment>
+class BlockPool {
+    constexpr static size_t BLOCKS_PER_CHUNK = 16;
+    constexpr static size_t BLOCK_STRIDE = (BlockSize + BlockAlignment - 1) / BlockAlignment * BlockAlignment;
+    // Each chunk starts with a pointer to the previously allocated chunk
+    constexpr static size_t CHUNK_HEADER_SIZE = (sizeof(void*) + BlockAlignment - 1) / BlockAlignment * BlockAlignment;
+
+    static_assert(BlockSize >= sizeof(void*));
+
+    void* _chunks = nullptr;
+    void* _free_list = nullptr;
+
+public:
+    BlockPool() = default;
+    BlockPool(const BlockPool& other) = delete;
+    ~BlockPool() { release(); }
+
+    void* alloc() {
+        if(!_free_list) {
+            size_t alignment = BlockAlignment > alignof(void*) ? BlockAlignment : alignof(void*);
+            uint8_t* chunk = (uint8_t*)zw_alloc(CHUNK_HEADER_SIZE + BLOCK_STRIDE * BLOCKS_PER_CHUNK, alignment);
+            assert(chunk && "allocator out of memory");
+            *(void**)chunk = _chunks;
+            _chunks = chunk;
+            for(size_t i = BLOCKS_PER_CHUNK; i > 0; i--) {
+                free(chunk + CHUNK_HEADER_SIZE + BLOCK_STRIDE * (i - 1));
+            }
+        }
+        void* block = _free_list;
+        _free_list = *(void**)block;
+        return block;
+    }
+
+    void free(void* block) {
+        *(void**)block = _free_list;
+        _free_list = block;
+    }
+
+    void release() {
+        while(_chunks) {
+            void* next = *(void**)_chunks;
+            zw_free(_chunks);
+            _chunks = next;
+        }
+        _free_list = nullptr;
+    }
+
+    friend void swap(BlockPool& left, BlockPool& right) {
+        std::swap(left._chunks, right._chunks);
+        std::swap(left._free_list, right._free_list);
+    }
+};
+
+template<typename K, typename V, size_t Capacity>
+struct BTreeInternalNode;
+
+// Keys come right after the header, so a search within a node only touches contiguous cache lines.
+template<typename K, typename V, size_t Capacity>
+struct BTreeNode {
+    BTreeInternalNode<K, V, Capacity>* parent = nullptr;
+    uint16_t parent_index = 0;
+    uint16_t count = 0;
+    bool is_leaf = true;
+    alignas(K) uint8_t key_storage[sizeof(K) * Capacity];
+    alignas(V) uint8_t value_storage[sizeof(V) * Capacity];
+
+    K* keys() { return (K*)key_storage; }
+    V* values() { return (V*)value_storage; }
+};
+
+template<typename K, typename V, size_t Capacity>
+struct BTreeInternalNode: BTreeNode<K, V, Capacity> {
+    BTreeNode<K, V, Capacity>* children[Capacity + 1];
+};
+
+};
+
+template<typename K, typename V>
+struct BTreeMapEntry {
+    const K& key;
+    V& value;
+};
+
+template<typename K, typename V, size_t Capacity, typename Ref>
+class BTreeIterator {
+    using Node = impl::BTreeNode<K, V, Capacity>;
+    using Internal = impl::BTreeInternalNode<K, V, Capacity>;
+
+    Node* node;
+    size_t index;
+public:
+    using Element = Ref;
+
+    BTreeIterator(Node* node, size_t index) : node(node), index(index) {}
+
+    BTreeIterator& operator++() {
+        if(!node->is_leaf) {
+            // The successor of an internal key is the leftmost entry of the subtree to its right
+            node = ((Internal*)node)->children[index + 1];
+            while(!node->is_leaf) {
+                node = ((Internal*)node)->children[0];
+            }
+            index = 0;
+        } else {
+            index++;
+            while(node && index == node->count) {
+                index = node->parent_index;
+                node = node->parent;
+            }
+            if(!node) index = 0;
+        }
+        return *this;
+    }
+
+    bool operator==(const BTreeIterator& other) const { return node == other.node && index == other.index; }
+    bool operator!=(const BTreeIterator& other) const { return !(*this == other); }
+    Ref operator*() { return Ref { node->keys()[index], node->values()[index] }; }
+};
+
+template<typename K, typename V, size_t Capacity, typename Ref>
+class BTreeIterable: public Iterable<BTreeIterable<K, V, Capacity, Ref>> {
+    using Iter = BTreeIterator<K, V, Capacity, Ref>;
+    Iter _begin;
+    Iter _end;
+public:
+    using Iterator = Iter;
+
+    BTreeIterable(Iter begin, Iter end) : _begin(begin), _end(end) {}
+    Iterator begin() const { return _begin; }
+    Iterator end() const { return _end; }
+};
+
+/// Ordered map implemented as a B-tree. Nodes hold as many keys as fit in about four cache lines, so a lookup
+/// touches few nodes and scans each one linearly from memory that is already being prefetched. Nodes come
+/// from per-map pools carved out of the context allocator, and are all given back at once when the map is
+/// destroyed or cleared.
+///
+/// Entries are relocated between nodes with memcpy, so like Array, K and V must be trivially relocatable.
+/// Lookups are templated on the query type, so e.g. a BTreeMap<String, V> can be queried with a StringSlice;
+/// Compare must order both types consistently.
+template<typename K, typename V, typename Compare = Less>
+class BTreeMap: ZwObject {
+    constexpr static size_t TARGET_NODE_KEY_BYTES = 4 * CACHE_LINE_SIZE;
+    // Every node except the root holds between MIN_DEGREE - 1 and 2 * MIN_DEGREE - 1 keys
+    constexpr static size_t MIN_DEGREE = TARGET_NODE_KEY_BYTES / sizeof(K) / 2 < 3 ? 3 :
+                                         TARGET_NODE_KEY_BYTES / sizeof(K) / 2 > 32 ? 32 :
+                                         TARGET_NODE_KEY_BYTES / sizeof(K) / 2;
+    constexpr static size_t CAPACITY = 2 * MIN_DEGREE - 1;
+
+    using Node = impl::BTreeNode<K, V, CAPACITY>;
+    using Internal = impl::BTreeInternalNode<K, V, CAPACITY>;
+    using Iterator = BTreeIterator<K, V, CAPACITY, BTreeMapEntry<K, V>>;
+    using ConstIterator = BTreeIterator<K, V, CAPACITY, BTreeMapEntry<K, const V>>;
+
+    struct Position {
+        Node* node;
+        size_t index;
+    };
+
+    enum class RemoveTarget { KEY, MIN, MAX };
+
+    Node* _root = nullptr;
+    size_t _size = 0;
+    impl::BlockPool<sizeof(Node), alignof(Node)> _leaf_pool;
+    impl::BlockPool<sizeof(Internal), alignof(Internal)> _internal_pool;
+
+    template<typename T>
+    static void relocate(T* dest, T* source, size_t count) {
+        memmove((void*)dest, (const void*)source, sizeof(T) * count);
+    }
+
+    static void set_child(Internal* node, size_t index, Node* child) {
+        node->children[index] = child;
+        child->parent = node;
+        child->parent_index = (uint16_t)index;
+    }
+    static void fix_children(Internal* node, size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++) {
+            set_child(node, i, node->children[i]);
+        }
+    }
+
+    Node* new_leaf() { return new(_leaf_pool.alloc()) Node; }
+    Internal* new_internal() {
+        Internal* node = new(_internal_pool.alloc()) Internal;
+        node->is_leaf = false;
+        return node;
+    }
+    void free_node(Node* node) {
+        if(node->is_leaf) {
+            _leaf_pool.free(node);
+        } else {
+            _internal_pool.free(node);
+        }
+    }
+
+    template<typename Q>
+    static size_t search(Node* node, const Q& key, bool* found) {
+        Compare less;
+        size_t index = impl::lower_bound(node->keys(), node->count, key, less);
+        *found = index < node->count && !less(key, node->keys()[index]);
+        return index;
+    }
+
+    template<typename Q>
+    Option<Position> find(const Q& key) const {
+        Node* node = _root;
+        while(node) {
+            bool found;
+            size_t index = search(node, key, &found);
+            if(found) {
+                return Position { node, index };
+            }
+            if(node->is_leaf) break;
+            node = ((Internal*)node)->children[index];
+        }
+        return {};
+    }
+
+    // Position of the first entry whose key is not less than key, or the end position.
+    template<typename Q>
+    Position lower_bound(const Q& key) const {
+        Position result { nullptr, 0 };
+        Node* node = _root;
+        while(node) {
+            bool found;
+            size_t index = search(node, key, &found);
+            if(index < node->count) {
+                // Everything further down is less than this entry, so a later candidate is always better
+                result = Position { node, index };
+                if(found) break;
+            }
+            if(node->is_leaf) break;
+            node = ((Internal*)node)->children[index];
+        }
+        return result;
+    }
+
+    Position first() const {
+        if(!_size) return Position { nullptr, 0 };
+
+        Node* node = _root;
+        while(!node->is_leaf) {
+            node = ((Internal*)node)->children[0];
+        }
+        return Position { node, 0 };
+    }
+
+    // Splits the full child at index into two nodes of MIN_DEGREE - 1 keys, moving its median up into node.
+    void split_child(Internal* node, size_t index) {
+        Node* left = node->children[index];
+        assert(left->count == CAPACITY);
+        Node* right = left->is_leaf ? new_leaf() : new_internal();
+
+        right->count = MIN_DEGREE - 1;
+        relocate(right->keys(), left->keys() + MIN_DEGREE, MIN_DEGREE - 1);
+        relocate(right->values(), left->values() + MIN_DEGREE, MIN_DEGREE - 1);
+        if(!left->is_leaf) {
+            for(auto i: Range(MIN_DEGREE)) {
+                set_child((Internal*)right, i, ((Internal*)left)->children[MIN_DEGREE + i]);
+            }
+        }
+        left->count = MIN_DEGREE - 1;
+
+        relocate(node->keys() + index + 1, node->keys() + index, node->count - index);
+        relocate(node->values() + index + 1, node->values() + index, node->count - index);
+        relocate(node->children + index + 2, node->children + index + 1, node->count - index);
+        relocate(node->keys() + index, left->keys() + MIN_DEGREE - 1, 1);
+        relocate(node->values() + index, left->values() + MIN_DEGREE - 1, 1);
+        node->count++;
+        node->children[index + 1] = right;
+        fix_children(node, index + 1, node->count + 1);
+    }
+
+    // Moves the last entry of the child at index up into node, and the separating entry down into the front
+    // of the child at index + 1.
+    void rotate_right(Internal* node, size_t index) {
+        Node* left = node->children[index];
+        Node* right = node->children[index + 1];
+
+        relocate(right->keys() + 1, right->keys(), right->count);
+        relocate(right->values() + 1, right->values(), right->count);
+        relocate(right->keys(), node->keys() + index, 1);
+        relocate(right->values(), node->values() + index, 1);
+        relocate(node->keys() + index, left->keys() + left->count - 1, 1);
+        relocate(node->values() + index, left->values() + left->count - 1, 1);
+        if(!right->is_leaf) {
+            Internal* r = (Internal*)right;
+            relocate(r->children + 1, r->children, right->count + 1);
+            r->children[0] = ((Internal*)left)->children[left->count];
+            fix_children(r, 0, right->count + 2);
+        }
+        left->count--;
+        right->count++;
+    }
+
+    // Moves the first entry of the child at index + 1 up into node, and the separating entry down onto the
+    // end of the child at index.
+    void rotate_left(Internal* node, size_t index) {
+        Node* left = node->children[index];
+        Node* right = node->children[index + 1];
+
+        relocate(left->keys() + left->count, node->keys() + index, 1);
+        relocate(left->values() + left->count, node->values() + index, 1);
+        relocate(node->keys() + index, right->keys(), 1);
+        relocate(node->values() + index, right->values(), 1);
+        relocate(right->keys(), right->keys() + 1, right->count - 1);
+        relocate(right->values(), right->values() + 1, right->count - 1);
+        if(!right->is_leaf) {
+            Internal* r = (Internal*)right;
+            set_child((Internal*)left, left->count + 1, r->children[0]);
+            relocate(r->children, r->children + 1, right->count);
+            fix_children(r, 0, right->count);
+        }
+        left->count++;
+        right->count--;
+    }
+
+    // Merges the child at index + 1 and the entry separating it into the child at index.
+    void merge_children(Internal* node, size_t index) {
+        Node* left = node->children[index];
+        Node* right = node->children[index + 1];
+        assert((size_t)left->count + right->count + 1 <= CAPACITY);
+
+        relocate(left->keys() + left->count, node->keys() + index, 1);
+        relocate(left->values() + left->count, node->values() + index, 1);
+        relocate(left->keys() + left->count + 1, right->keys(), right->count);
+        relocate(left->values() + left->count + 1, right->values(), right->count);
+        if(!left->is_leaf) {
+            for(auto i: Range(right->count + 1)) {
+                set_child((Internal*)left, left->count + 1 + i, ((Internal*)right)->children[i]);
+            }
+        }
+        left->count += 1 + right->count;
+
+        relocate(node->keys() + index, node->keys() + index + 1, node->count - index - 1);
+        relocate(node->values() + index, node->values() + index + 1, node->count - index - 1);
+        relocate(node->children + index + 1, node->children + index + 2, node->count - index - 1);
+        node->count--;
+        fix_children(node, index + 1, node->count + 1);
+        free_node(right);
+    }
+
+    // Makes sure the child at index has at least MIN_DEGREE keys, so that removing from it can't underflow.
+    // Returns the index of that child afterwards, which changes if it was merged into its left sibling.
+    size_t fill_child(Internal* node, size_t index) {
+        if(node->children[index]->count >= MIN_DEGREE) return index;
+
+        if(index > 0 && node->children[index - 1]->count >= MIN_DEGREE) {
+            rotate_right(node, index - 1);
+        } else if(index < node->count && node->children[index + 1]->count >= MIN_DEGREE) {
+            rotate_left(node, index);
+        } else if(index < node->count) {
+            merge_children(node, index);
+        } else {
+            merge_children(node, index - 1);
+            index--;
+        }
+        return index;
+    }
+
+    // Removes an entry from the subtree under node in a single pass down, refilling each child before
+    // descending into it. The removed key and value are relocated into the uninitialized storage at out_key
+    // and out_value.
+    template<typename Q>
+    bool remove_entry(Node* node, RemoveTarget target, const Q* key, K* out_key, V* out_value) {
+        for(;;) {
+            bool found = false;
+            size_t index;
+            if(target == RemoveTarget::KEY) {
+                index = search(node, *key, &found);
+            } else if(target == RemoveTarget::MIN) {
+                index = 0;
+                found = node->is_leaf;
+            } else {
+                index = node->is_leaf ? node->count - 1 : node->count;
+                found = node->is_leaf;
+            }
+
+            if(node->is_leaf) {
+                if(!found) return false;
+
+                relocate(out_key, node->keys() + index, 1);
+                relocate(out_value, node->values() + index, 1);
+                relocate(node->keys() + index, node->keys() + index + 1, node->count - index - 1);
+                relocate(node->values() + index, node->values() + index + 1, node->count - index - 1);
+                node->count--;
+                return true;
+            }
+
+            Internal* internal = (Internal*)node;
+            if(found) {
+                // Replace the entry with its predecessor or successor, taken from whichever side can spare one.
+                Node* left = internal->children[index];
+                Node* right = internal->children[index + 1];
+                if(left->count >= MIN_DEGREE || right->count >= MIN_DEGREE) {
+                    relocate(out_key, node->keys() + index, 1);
+                    relocate(out_value, node->values() + index, 1);
+                    if(left->count >= MIN_DEGREE) {
+                        remove_entry<Q>(left, RemoveTarget::MAX, nullptr, node->keys() + index, node->values() + index);
+                    } else {
+                        remove_entry<Q>(right, RemoveTarget::MIN, nullptr, node->keys() + index, node->values() + index);
+                    }
+                    return true;
+                }
+                merge_children(internal, index);
+                node = left;
+                continue;
+            }
+
+            node = internal->children[fill_child(internal, index)];
+        }
+    }
+
+    template<typename Q>
+    bool remove_entry(const Q& key, K* out_key, V* out_value) {
+        if(!_root) return false;
+
+        bool removed = remove_entry(_root, RemoveTarget::KEY, &key, out_key, out_value);
+        if(!_root->is_leaf && !_root->count) {
+            // The root's last entry was merged down into its only child
+            Node* old_root = _root;
+            _root = ((Internal*)_root)->children[0];
+            _root->parent = nullptr;
+            _root->parent_index = 0;
+            free_node(old_root);
+        }
+        if(removed) {
+            _size--;
+        }
+        return removed;
+    }
+
+    // Returns the position holding key if there is one. Otherwise moves key into a new entry, sets *inserted
+    // and returns its position with the value uninitialized; the caller must construct a V there.
+    Position find_or_prepare_insert(K& key, bool* inserted) {
+        if(!_root) {
+            _root = new_leaf();
+        }
+        if(_root->count == CAPACITY) {
+            Internal* new_root = new_internal();
+            set_child(new_root, 0, _root);
+            _root = new_root;
+            split_child(new_root, 0);
+        }
+
+        Compare less;
+        Node* node = _root;
+        for(;;) {
+            bool found;
+            size_t index = search(node, key, &found);
+            if(found) {
+                *inserted = false;
+                return Position { node, index };
+            }
+            if(node->is_leaf) {
+                relocate(node->keys() + index + 1, node->keys() + index, node->count - index);
+                relocate(node->values() + index + 1, node->values() + index, node->count - index);
+                new(&node->keys()[index]) K(std::move(key));
+                node->count++;
+                _size++;
+                *inserted = true;
+                return Position { node, index };
+            }
+
+            Internal* internal = (Internal*)node;
+            if(internal->children[index]->count == CAPACITY) {
+                split_child(internal, index);
+                // The child's median is now at index; key belongs either at it or on one side of it
+                if(!less(key, node->keys()[index])) {
+                    if(!less(node->keys()[index], key)) {
+                        *inserted = false;
+                        return Position { node, index };
+                    }
+                    index++;
+                }
+            }
+            node = internal->children[index];
+        }
+    }
+
+    void destroy_entries(Node* node) {
+        if constexpr(!std::is_trivially_destructible_v<K> || !std::is_trivially_destructible_v<V>) {
+            for(auto i: Range(node->count)) {
+                node->keys()[i].~K();
+                node->values()[i].~V();
+            }
+            if(!node->is_leaf) {
+                for(auto i: Range(node->count + 1)) {
+                    destroy_entries(((Internal*)node)->children[i]);
+                }
+            }
+        }
+    }
+
+    Node* clone(Node* source) {
+        Node* node = source->is_leaf ? new_leaf() : new_internal();
+        for(auto i: Range(source->count)) {
+            new(&node->keys()[i]) K(source->keys()[i]);
+            new(&node->values()[i]) V(source->values()[i]);
+        }
+        node->count = source->count;
+        if(!source->is_leaf) {
+            for(auto i: Range(source->count + 1)) {
+                set_child((Internal*)node, i, clone(((Internal*)source)->children[i]));
+            }
+        }
+        return node;
+    }
+
+public:
+    BTreeMap() = default;
+    BTreeMap(const BTreeMap<K, V, Compare>& other) : ZwObject(other) {
+        if(other._root) {
+            _root = clone(other._root);
+            _size = other._size;
+        }
+    }
+    BTreeMap(BTreeMap<K, V, Compare>&& other) noexcept {
+        swap(*this, other);
+    }
+
+    BTreeMap<K, V, Compare>& operator=(const BTreeMap<K, V, Compare>& other) {
+        if(this != &other) {
+            BTreeMap<K, V, Compare> temp = other;
+            swap(*this, temp);
+        }
+        return *this;
+    }
+
+    BTreeMap<K, V, Compare>& operator=(BTreeMap<K, V, Compare>&& other) {
+        if(this != &other) {
+            BTreeMap<K, V, Compare> temp = std::move(other);
+            swap(*this, temp);
+        }
+        return *this;
+    }
+
+    ~BTreeMap() {
+        if(_root) {
+            destroy_entries(_root);
+        }
+    }
+
+    size_t size() const { return _size; }
+    bool is_empty() const { return _size == 0; }
+
+    void clear() {
+        if(_root) {
+            destroy_entries(_root);
+        }
+        _root = nullptr;
+        _size = 0;
+        _leaf_pool.release();
+        _internal_pool.release();
+    }
+
+    /// Returns true if the key was newly inserted, or false if it was already present, in which case
+    /// the existing value is replaced.
+    bool insert(K key, V value) {
+        bool inserted;
+        Position position = find_or_prepare_insert(key, &inserted);
+        if(inserted) {
+            new(&position.node->values()[position.index]) V(std::move(value));
+        } else {
+            position.node->values()[position.index] = std::move(value);
+        }
+        return inserted;
+    }
+
+    /// Returns the value for key, inserting a default-constructed one first if it isn't present.
+    V& get_or_insert(K key) requires std::default_initializable<V> {
+        bool inserted;
+        Position position = find_or_prepare_insert(key, &inserted);
+        if(inserted) {
+            new(&position.node->values()[position.index]) V();
+        }
+        return position.node->values()[position.index];
+    }
+
+    template<typename Q>
+    Option<const V*> get(const Q& key) const {
+        Option<Position> position = find(key);
+        if(position.is_present()) {
+            return (const V*)&position.unwrap().node->values()[position.unwrap().index];
+        }
+        return {};
+    }
+
+    template<typename Q>
+    Option<V*> get(const Q& key) {
+        Option<Position> position = find(key);
+        if(position.is_present()) {
+            return &position.unwrap().node->values()[position.unwrap().index];
+        }
+        return {};
+    }
+
+    template<typename Q>
+    bool contains(const Q& key) const {
+        return find(key).is_present();
+    }
+
+    template<typename Q>
+    bool remove(const Q& key) {
+        alignas(K) uint8_t removed_key[sizeof(K)];
+        alignas(V) uint8_t removed_value[sizeof(V)];
+        if(remove_entry(key, (K*)removed_key, (V*)removed_value)) {
+            ((K*)removed_key)->~K();
+            ((V*)removed_value)->~V();
+            return true;
+        }
+        return false;
+    }
+
+    /// Removes key from the map and moves its value out.
+    template<typename Q>
+    Option<V> take(const Q& key) {
+        alignas(K) uint8_t removed_key[sizeof(K)];
+        alignas(V) uint8_t removed_value[sizeof(V)];
+        if(remove_entry(key, (K*)removed_key, (V*)removed_value)) {
+            Option<V> value = std::move(*(V*)removed_value);
+            ((K*)removed_key)->~K();
+            ((V*)removed_value)->~V();
+            return value;
+        }
+        return {};
+    }
+
+    /// Iterates over BTreeMapEntry<K, V> in key order.
+    BTreeIterable<K, V, CAPACITY, BTreeMapEntry<K, const V>> iter() const {
+        Position begin = first();
+        return { ConstIterator(begin.node, begin.index), ConstIterator(nullptr, 0) };
+    }
+    BTreeIterable<K, V, CAPACITY, BTreeMapEntry<K, V>> iter_mut() {
+        Position begin = first();
+        return { Iterator(begin.node, begin.index), Iterator(nullptr, 0) };
+    }
+
+    /// Iterates in key order over the entries with keys in [lower, upper).
+    template<typename Q>
+    BTreeIterable<K, V, CAPACITY, BTreeMapEntry<K, const V>> range(const Q& lower, const Q& upper) const {
+        Position begin = lower_bound(lower);
+        Position end = Compare()(upper, lower) ? begin : lower_bound(upper);
+        return { ConstIterator(begin.node, begin.index), ConstIterator(end.node, end.index) };
+    }
+    template<typename Q>
+    BTreeIterable<K, V, CAPACITY, BTreeMapEntry<K, V>> range_mut(const Q& lower, const Q& upper) {
+        Position begin = lower_bound(lower);
+        Position end = Compare()(upper, lower) ? begin : lower_bound(upper);
+        return { Iterator(begin.node, begin.index), Iterator(end.node, end.index) };
+    }
+
+    friend void swap(BTreeMap<K, V, Compare>& left, BTreeMap<K, V, Compare>& right) {
+        std::swap(left._root, right._root);
+        std::swap(left._size, right._size);
+        swap(left._leaf_pool, right._leaf_pool);
+        swap(left._internal_pool, right._internal_pool);
+    }
+};
+
+};
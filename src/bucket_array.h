@@ -0,0 +1,202 @@
+#pragma once
+
+#include <assert.h>
+#include <bit>
+#include <type_traits>
+#include <utility>
+
+#include "alloc.h"
+#include "array.h"
+#include "range.h"
+
+namespace zw {
+
+template<typename T, typename Ref>
+class BucketArrayIterator {
+    T* const* buckets;
+    size_t index;
+    size_t shift;
+
+public:
+    using Element = Ref;
+
+    BucketArrayIterator(T* const* buckets, size_t index, size_t shift) : buckets(buckets), index(index), shift(shift) {}
+
+    BucketArrayIterator<T, Ref>& operator++() {
+        ++index;
+        return *this;
+    }
+
+    bool operator==(const BucketArrayIterator<T, Ref>& other) const { return index == other.index; }
+    bool operator!=(const BucketArrayIterator<T, Ref>& other) const { return index != other.index; }
+    Ref operator*() { return buckets[index >> shift][index & ((1ull << shift) - 1)]; }
+};
+
+template<typename T, typename Ref>
+class BucketArrayIterable: public Iterable<BucketArrayIterable<T, Ref>> {
+    T* const* buckets;
+    size_t size;
+    size_t shift;
+
+public:
+    using Iterator = BucketArrayIterator<T, Ref>;
+
+    BucketArrayIterable(T* const* buckets, size_t size, size_t shift) : buckets(buckets), size(size), shift(shift) {}
+    Iterator begin() const { return Iterator(buckets, 0, shift); }
+    Iterator end() const { return Iterator(buckets, size, shift); }
+    size_t size_hint() const { return size; }
+};
+
+/// Growable array that allocates its elements in fixed-size buckets from the context allocator.
+/// Growing never moves existing elements, so pointers and references to them stay valid until the
+/// element itself is removed.
+template<typename T, size_t BucketSize = 64>
+class BucketArray: ZwObject {
+    static_assert(BucketSize > 0 && (BucketSize & (BucketSize - 1)) == 0, "BucketSize must be a power of two");
+    constexpr static size_t SHIFT = std::countr_zero(BucketSize);
+    constexpr static size_t MASK = BucketSize - 1;
+
+    Array<T*> _buckets;
+    size_t _size = 0;
+
+    void add_bucket() {
+        T* bucket = (T*)zw_alloc(sizeof(T) * BucketSize, alignof(T));
+        assert(bucket && "allocator out of memory");
+        _buckets.push(bucket);
+    }
+
+    T* make_room() {
+        if(_size == cap()) {
+            add_bucket();
+        }
+        return &_buckets[_size >> SHIFT][_size & MASK];
+    }
+
+    void destroy_elements() {
+        if constexpr(!std::is_trivially_destructible_v<T>) {
+            for(auto i: indices()) {
+                (*this)[i].~T();
+            }
+        }
+    }
+
+public:
+    BucketArray() = default;
+    BucketArray(const BucketArray<T, BucketSize>& other) : ZwObject(other) {
+        reserve(other._size);
+        for(auto i: other.indices()) {
+            new(&_buckets[i >> SHIFT][i & MASK]) T(other[i]);
+        }
+        _size = other._size;
+    }
+    BucketArray(BucketArray<T, BucketSize>&& other) noexcept : _buckets(std::move(other._buckets)), _size(other._size) {
+        other._size = 0;
+    }
+
+    BucketArray<T, BucketSize>& operator=(const BucketArray<T, BucketSize>& other) {
+        if(this != &other) {
+            BucketArray<T, BucketSize> temp = other;
+            swap(*this, temp);
+        }
+        return *this;
+    }
+
+    BucketArray<T, BucketSize>& operator=(BucketArray<T, BucketSize>&& other) {
+        if(this != &other) {
+            BucketArray<T, BucketSize> temp = std::move(other);
+            swap(*this, temp);
+        }
+        return *this;
+    }
+
+    ~BucketArray() {
+        destroy_elements();
+        for(auto bucket: _buckets.iter()) {
+            zw_free(bucket);
+        }
+    }
+
+    size_t size() const { return _size; }
+    size_t cap() const { return _buckets.size() * BucketSize; }
+    Range indices() const { return Range(_size); }
+    bool is_empty() const { return _size == 0; }
+
+    void reserve(size_t min_cap) {
+        while(cap() < min_cap) {
+            add_bucket();
+        }
+    }
+
+    T& push(const T& element) {
+        T* slot = make_room();
+        new(slot) T(element);
+        _size++;
+        return *slot;
+    }
+
+    T& push(T&& element) {
+        T* slot = make_room();
+        new(slot) T(std::move(element));
+        _size++;
+        return *slot;
+    }
+
+    /// Removes the element at index by moving the last element into its place. O(1), but doesn't
+    /// preserve order, and invalidates pointers to the last element.
+    void swap_remove(size_t index) {
+        assert(index < _size);
+        T& removed = (*this)[index];
+        T& last_element = last();
+        if(&removed != &last_element) {
+            removed = std::move(last_element);
+        }
+        last_element.~T();
+        _size--;
+    }
+
+    /// Destroys all elements, but keeps the buckets around for reuse.
+    void clear() {
+        destroy_elements();
+        _size = 0;
+    }
+
+    /// Destroys all elements and forgets all buckets without returning them to the allocator.
+    /// Meant for when the context allocator is a LinearAllocator (or similar) that is about to be reset
+    /// in one go anyway; otherwise, the buckets are leaked.
+    void reset_without_freeing() {
+        destroy_elements();
+        _size = 0;
+        // Overwritten without being destructed, so that the bucket table isn't freed either.
+        new(&_buckets) Array<T*>();
+    }
+
+    const T& operator[](size_t index) const {
+        assert(index < _size);
+        return _buckets[index >> SHIFT][index & MASK];
+    }
+
+    T& operator[](size_t index) {
+        assert(index < _size);
+        return _buckets[index >> SHIFT][index & MASK];
+    }
+
+    T& last() {
+        assert(_size > 0);
+        return (*this)[_size - 1];
+    }
+
+    const T& last() const {
+        assert(_size > 0);
+        return (*this)[_size - 1];
+    }
+
+    BucketArrayIterable<const T, const T&> iter() const { return {(const T* const*)_buckets.data(), _size, SHIFT}; }
+    BucketArrayIterable<T, T&> iter_mut() { return {_buckets.data(), _size, SHIFT}; }
+
+    friend void swap(BucketArray<T, BucketSize>& left, BucketArray<T, BucketSize>& right) {
+        swap(left._buckets, right._buckets);
+        std::swap(left._size, right._size);
+    }
+};
+
+};
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <assert.h>
+#include <atomic>
+#include <bit>
+#include <type_traits>
+#include <utility>
+
+#include "alloc.h"
+#include "misc.h"
+#include "option.h"
+#include "range.h"
+
+namespace zw {
+
+/// Bounded, lock-free single-producer/single-consumer queue. Exactly one thread may push and exactly one
+/// thread may pop at a time. The producer and consumer indices live on separate cache lines, and each side
+/// keeps a cached copy of the other's index so that it only touches the shared line when it appears full/empty.
+///
+/// Since the queue is shared between threads, it holds on to the allocator its storage came from instead of
+/// freeing through the context allocator of whichever thread destroys it.
+template<typename T>
+class SpscQueue {
+    Allocator* _allocator;
+    T* _slots;
+    size_t _mask;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _head {0};
+    size_t _cached_tail = 0;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _tail {0};
+    size_t _cached_head = 0;
+
+    // Number of free slots as seen by the producer, refreshing the cached head only if needed.
+    size_t free_slots(size_t tail, size_t wanted) {
+        size_t cap = _mask + 1;
+        if(cap - (tail - _cached_head) < wanted) {
+            _cached_head = _head.load(std::memory_order_acquire);
+        }
+        return cap - (tail - _cached_head);
+    }
+
+    // Number of ready slots as seen by the consumer, refreshing the cached tail only if needed.
+    size_t ready_slots(size_t head, size_t wanted) {
+        if(_cached_tail - head < wanted) {
+            _cached_tail = _tail.load(std::memory_order_acquire);
+        }
+        return _cached_tail - head;
+    }
+
+public:
+    explicit SpscQueue(size_t min_cap, Allocator* allocator = zw_get_ctx(allocator)) : _allocator(allocator) {
+        size_t cap = std::bit_ceil(min_cap < 2 ? 2 : min_cap);
+        _slots = (T*)zw_alloc(_allocator, sizeof(T) * cap, alignof(T));
+        assert(_slots && "allocator out of memory");
+        _mask = cap - 1;
+    }
+
+    SpscQueue(const SpscQueue<T>& other) = delete;
+    SpscQueue(SpscQueue<T>&& other) = delete;
+
+    ~SpscQueue() {
+        if constexpr(!std::is_trivially_destructible_v<T>) {
+            size_t tail = _tail.load(std::memory_order_relaxed);
+            for(size_t i = _head.load(std::memory_order_relaxed); i != tail; i++) {
+                _slots[i & _mask].~T();
+            }
+        }
+        zw_free(_allocator, _slots);
+    }
+
+    size_t cap() const { return _mask + 1; }
+
+    /// Producer only. Returns false if the queue is full.
+    bool try_push(T&& element) {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if(!free_slots(tail, 1)) return false;
+
+        new(&_slots[tail & _mask]) T(std::move(element));
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& element) {
+        T copy = element;
+        return try_push(std::move(copy));
+    }
+
+    /// Producer only. Copies as many of the count elements at items as fit, publishing them all at once.
+    /// Returns how many were pushed.
+    size_t push_many(const T* items, size_t count) {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        size_t free = free_slots(tail, count);
+        size_t num_pushed = count < free ? count : free;
+        for(auto i: Range(num_pushed)) {
+            new(&_slots[(tail + i) & _mask]) T(items[i]);
+        }
+        _tail.store(tail + num_pushed, std::memory_order_release);
+        return num_pushed;
+    }
+
+    /// Consumer only.
+    Option<T> try_pop() {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if(!ready_slots(head, 1)) return {};
+
+        T& slot = _slots[head & _mask];
+        Option<T> result = std::move(slot);
+        slot.~T();
+        _head.store(head + 1, std::memory_order_release);
+        return result;
+    }
+
+    /// Consumer only. Moves up to count elements into out, which must point to count constructed elements.
+    /// Returns how many were popped.
+    size_t pop_many(T* out, size_t count) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t ready = ready_slots(head, count);
+        size_t num_popped = count < ready ? count : ready;
+        for(auto i: Range(num_popped)) {
+            T& slot = _slots[(head + i) & _mask];
+            out[i] = std::move(slot);
+            slot.~T();
+        }
+        _head.store(head + num_popped, std::memory_order_release);
+        return num_popped;
+    }
+};
+
+/// Bounded, lock-free multi-producer/multi-consumer queue (Dmitry Vyukov's design). Every cell carries a
+/// sequence number telling producers and consumers which lap of the ring it is ready for, so the only
+/// contended operations are the CAS on the enqueue and dequeue positions, which sit on separate cache lines.
+template<typename T>
+class MpmcQueue {
+    struct Cell {
+        std::atomic<size_t> sequence;
+        alignas(T) uint8_t storage[sizeof(T)];
+
+        T* element() { return (T*)storage; }
+    };
+
+    Allocator* _allocator;
+    Cell* _cells;
+    size_t _mask;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _enqueue_pos {0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _dequeue_pos {0};
+
+    // Claims up to count consecutive positions whose cells have sequence number pos + offset, where pos is
+    // the claimed start. A cell that is observed to be ready stays ready until the claiming CAS succeeds or
+    // fails, since nobody else can take it without first moving position past it.
+    size_t claim(std::atomic<size_t>& position, size_t offset, size_t count, size_t* start) {
+        size_t pos = position.load(std::memory_order_relaxed);
+        for(;;) {
+            size_t num_ready = 0;
+            while(num_ready < count) {
+                size_t sequence = _cells[(pos + num_ready) & _mask].sequence.load(std::memory_order_acquire);
+                if(sequence != pos + num_ready + offset) break;
+                num_ready++;
+            }
+            if(!num_ready) {
+                // Either the queue is full/empty, or another thread claimed pos in the meantime.
+                size_t current = position.load(std::memory_order_relaxed);
+                if(current == pos) return 0;
+                pos = current;
+                continue;
+            }
+            if(position.compare_exchange_weak(pos, pos + num_ready, std::memory_order_relaxed)) {
+                *start = pos;
+                return num_ready;
+            }
+        }
+    }
+
+public:
+    explicit MpmcQueue(size_t min_cap, Allocator* allocator = zw_get_ctx(allocator)) : _allocator(allocator) {
+        size_t cap = std::bit_ceil(min_cap < 2 ? 2 : min_cap);
+        _cells = (Cell*)zw_alloc(_allocator, sizeof(Cell) * cap, alignof(Cell));
+        assert(_cells && "allocator out of memory");
+        for(auto i: Range(cap)) {
+            new(&_cells[i].sequence) std::atomic<size_t>(i);
+        }
+        _mask = cap - 1;
+    }
+
+    MpmcQueue(const MpmcQueue<T>& other) = delete;
+    MpmcQueue(MpmcQueue<T>&& other) = delete;
+
+    ~MpmcQueue() {
+        if constexpr(!std::is_trivially_destructible_v<T>) {
+            size_t end = _enqueue_pos.load(std::memory_order_relaxed);
+            for(size_t i = _dequeue_pos.load(std::memory_order_relaxed); i != end; i++) {
+                _cells[i & _mask].element()->~T();
+            }
+        }
+        zw_free(_allocator, _cells);
+    }
+
+    size_t cap() const { return _mask + 1; }
+
+    /// Returns false if the queue is full.
+    bool try_push(T&& element) {
+        size_t pos;
+        if(!claim(_enqueue_pos, 0, 1, &pos)) return false;
+
+        Cell& cell = _cells[pos & _mask];
+        new(cell.element()) T(std::move(element));
+        cell.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& element) {
+        T copy = element;
+        return try_push(std::move(copy));
+    }
+
+    /// Copies as many of the count elements at items as there are consecutive free cells for, claiming
+    /// them with a single CAS. Returns how many were pushed.
+    size_t push_many(const T* items, size_t count) {
+        size_t pos;
+        size_t num_pushed = claim(_enqueue_pos, 0, count, &pos);
+        for(auto i: Range(num_pushed)) {
+            Cell& cell = _cells[(pos + i) & _mask];
+            new(cell.element()) T(items[i]);
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return num_pushed;
+    }
+
+    Option<T> try_pop() {
+        size_t pos;
+        if(!claim(_dequeue_pos, 1, 1, &pos)) return {};
+
+        Cell& cell = _cells[pos & _mask];
+        Option<T> result = std::move(*cell.element());
+        cell.element()->~T();
+        cell.sequence.store(pos + _mask + 1, std::memory_order_release);
+        return result;
+    }
+
+    /// Moves up to count elements into out, which must point to count constructed elements, claiming them
+    /// with a single CAS. Returns how many were popped.
+    size_t pop_many(T* out, size_t count) {
+        size_t pos;
+        size_t num_popped = claim(_dequeue_pos, 1, count, &pos);
+        for(auto i: Range(num_popped)) {
+            Cell& cell = _cells[(pos + i) & _mask];
+            out[i] = std::move(*cell.element());
+            cell.element()->~T();
+            cell.sequence.store(pos + i + _mask + 1, std::memory_order_release);
+        }
+        return num_popped;
+    }
+};
+
+};
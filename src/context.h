@@ -11,4 +11,4 @@
     auto ZW_CONCAT(__ctx_old_value__, __LINE__ ## __VA_ARGS__) = name##_zw_ctx_var; \
     name##_zw_ctx_var = new_value; \
     zw_defer(name##_zw_ctx_var = ZW_CONCAT(__ctx_old_value__, __LINE__ ## __VA_ARGS__), __VA_ARGS__)
-#define zw_get_ctx(name) ([&] { return name##_zw_ctx_var; }())
+#define zw_get_ctx(name) ([] { return name##_zw_ctx_var; }())
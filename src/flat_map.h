@@ -0,0 +1,196 @@
+#pragma once
+
+#include <assert.h>
+#include <utility>
+
+#include "array.h"
+#include "option.h"
+#include "range.h"
+#include "sort.h"
+
+namespace zw {
+
+/// Ordered map stored as two parallel sorted Arrays, one of keys and one of values. Lookups are a binary
+/// search over the densely packed keys, which makes this the better choice over BTreeMap for data that is
+/// built once and read many times.
+///
+/// Single inserts shift the tail of both arrays. To build the map from many entries, add them with
+/// batch_insert() and then call commit_batch(), which sorts the batch and merges it in one pass.
+/// Lookups are templated on the query type, so e.g. a FlatMap<String, V> can be queried with a StringSlice;
+/// Compare must order both types consistently.
+template<typename K, typename V, typename Compare = Less>
+class FlatMap {
+    Array<K> _keys;
+    Array<V> _values;
+    // Entries past this index were added by batch_insert() and have not been merged yet
+    size_t _num_sorted = 0;
+
+    template<typename Q>
+    size_t lower_bound_index(const Q& key) const {
+        assert(_num_sorted == _keys.size() && "FlatMap has an uncommitted batch");
+        Compare less;
+        return impl::lower_bound(_keys.data(), _keys.size(), key, less);
+    }
+
+    template<typename Q>
+    Option<size_t> find(const Q& key) const {
+        size_t index = lower_bound_index(key);
+        if(index < _keys.size() && !Compare()(key, _keys[index])) {
+            return index;
+        }
+        return {};
+    }
+
+public:
+    size_t size() const { return _keys.size(); }
+    bool is_empty() const { return _keys.is_empty(); }
+
+    void reserve(size_t min_size) {
+        _keys.reserve(min_size);
+        _values.reserve(min_size);
+    }
+    void clear() {
+        _keys.clear();
+        _values.clear();
+        _num_sorted = 0;
+    }
+
+    /// Returns true if the key was newly inserted, or false if it was already present, in which case
+    /// the existing value is replaced.
+    bool insert(K key, V value) {
+        size_t index = lower_bound_index(key);
+        if(index < _keys.size() && !Compare()(key, _keys[index])) {
+            _values[index] = std::move(value);
+            return false;
+        }
+        _keys.insert(index, std::move(key));
+        _values.insert(index, std::move(value));
+        _num_sorted++;
+        return true;
+    }
+
+    /// Queues an entry to be merged in by commit_batch(). Lookups are not allowed until then.
+    /// If a key is added more than once, the last value added wins, including over an existing entry.
+    void batch_insert(K key, V value) {
+        _keys.push(std::move(key));
+        _values.push(std::move(value));
+    }
+
+    /// Sorts the entries added by batch_insert() and merges them with the existing ones.
+    void commit_batch() {
+        size_t num_pending = _keys.size() - _num_sorted;
+        if(!num_pending) return;
+
+        Compare less;
+        // Sort the batch indirectly, so that keys and values only move once, during the merge.
+        // Stable, so that among equal keys the one added last stays last.
+        Array<size_t> order;
+        order.reserve(num_pending);
+        for(auto i: Range(_num_sorted, _keys.size())) {
+            order.push(i);
+        }
+        order.stable_sort_by([&](size_t a, size_t b) { return less(_keys[a], _keys[b]); });
+
+        Array<K> keys;
+        Array<V> values;
+        keys.reserve(_keys.size());
+        values.reserve(_keys.size());
+        size_t i = 0;
+        size_t j = 0;
+        while(i < _num_sorted || j < num_pending) {
+            if(j == num_pending || (i < _num_sorted && less(_keys[i], _keys[order[j]]))) {
+                keys.push(std::move(_keys[i]));
+                values.push(std::move(_values[i]));
+                i++;
+                continue;
+            }
+            // Collapse a run of equal keys in the batch to its last entry, which also replaces an
+            // existing entry with the same key
+            while(j + 1 < num_pending && !less(_keys[order[j]], _keys[order[j + 1]])) {
+                j++;
+            }
+            size_t pending = order[j++];
+            if(i < _num_sorted && !less(_keys[pending], _keys[i])) {
+                i++;
+            }
+            keys.push(std::move(_keys[pending]));
+            values.push(std::move(_values[pending]));
+        }
+
+        _keys = std::move(keys);
+        _values = std::move(values);
+        _num_sorted = _keys.size();
+    }
+
+    template<typename Q>
+    Option<const V*> get(const Q& key) const {
+        Option<size_t> index = find(key);
+        if(index.is_present()) {
+            return &_values[index.unwrap()];
+        }
+        return {};
+    }
+
+    template<typename Q>
+    Option<V*> get(const Q& key) {
+        Option<size_t> index = find(key);
+        if(index.is_present()) {
+            return &_values[index.unwrap()];
+        }
+        return {};
+    }
+
+    template<typename Q>
+    bool contains(const Q& key) const {
+        return find(key).is_present();
+    }
+
+    template<typename Q>
+    bool remove(const Q& key) {
+        Option<size_t> index = find(key);
+        if(index.is_present()) {
+            _keys.erase(index.unwrap());
+            _values.erase(index.unwrap());
+            _num_sorted--;
+            return true;
+        }
+        return false;
+    }
+
+    /// Removes key from the map and moves its value out.
+    template<typename Q>
+    Option<V> take(const Q& key) {
+        Option<size_t> index = find(key);
+        if(index.is_present()) {
+            Option<V> value = std::move(_values[index.unwrap()]);
+            _keys.erase(index.unwrap());
+            _values.erase(index.unwrap());
+            _num_sorted--;
+            return value;
+        }
+        return {};
+    }
+
+    /// Indices of the entries with keys in [lower, upper), for use with key_at() and value_at().
+    template<typename Q>
+    Range range(const Q& lower, const Q& upper) const {
+        size_t begin = lower_bound_index(lower);
+        size_t end = lower_bound_index(upper);
+        return Range(begin, end < begin ? begin : end);
+    }
+
+    const K& key_at(size_t index) const { return _keys[index]; }
+    const V& value_at(size_t index) const { return _values[index]; }
+    V& value_at(size_t index) { return _values[index]; }
+
+    /// The keys and values in key order.
+    ConstArrayIterable<K> keys() const { return _keys.iter(); }
+    ConstArrayIterable<V> values() const { return _values.iter(); }
+    MutArrayIterable<V> values_mut() { return _values.iter_mut(); }
+
+    /// Iterates over pairs of (key, value) references in key order.
+    auto iter() const { return keys().zip(values()); }
+    auto iter_mut() { return keys().zip(values_mut()); }
+};
+
+};
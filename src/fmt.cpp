@@ -1,4 +1,7 @@
 #include <stdio.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 #include "fmt.h"
 #include "context.h"
@@ -11,66 +14,179 @@ ZW_DEFINE_CTX_VAR(uint32_t, indent, 0);
 
 namespace zw {
 
-extern StdFilePrinter stdout_printer{stdout};
-extern StdFilePrinter stderr_printer{stderr};
-extern DebugPrinter debug_printer{};
+StdFilePrinter stdout_printer{stdout};
+StdFilePrinter stderr_printer{stderr};
+DebugPrinter debug_printer{};
 
 void StdFilePrinter::print(StringSlice string) {
-    fprintf(file, "%.*s", (uint32_t)string.size(), string.data());
+    fwrite(string.data(), 1, string.size(), file);
 }
 
 void StdFilePrinter::print(WideStringSlice string) {
     fprintf(file, "%.*S", (uint32_t)string.size(), string.data());
 }
 
-void DebugPrinter::print(StringSlice string) {
-    auto null_terminated = string.c_string();
-    OutputDebugStringA(null_terminated->data());
+void StdFilePrinter::sync() {
+    fflush(file);
 }
 
-void DebugPrinter::print(WideStringSlice string) {
-    auto null_terminated = string.c_string();
-    OutputDebugStringW(null_terminated->data());
+BufferedPrinter::BufferedPrinter(Printer* sink, FlushPolicy policy, size_t cap, Allocator* allocator) : _sink(sink), _allocator(allocator), _size(0), _cap(cap), _policy(policy) {
+    _buffer = (char*)zw_alloc(_allocator, _cap, 1);
+    assert(_buffer && "allocator out of memory");
 }
 
-namespace impl {
+BufferedPrinter::~BufferedPrinter() {
+    flush();
+    zw_free(_allocator, _buffer);
+}
 
-enum class TokenKind {
-    Slice,
-    Curlies,
-};
-struct Token {
-    TokenKind kind;
-    StringSlice slice;
-};
+void BufferedPrinter::flush() {
+    if(_size) {
+        _sink->print(StringSlice(_buffer, _size));
+        _size = 0;
+    }
+}
+
+void BufferedPrinter::sync() {
+    flush();
+    _sink->sync();
+}
 
-template<size_t N>
-struct StaticString {
-    char data[N];
-    static constexpr size_t num = N;
-    constexpr StaticString(const char (&string)[N]) {
-        for(auto i: Range(N)) {
-            data[i] = string[i];
+// Flushes enough to fit size more characters, keeping an unfinished last line in the buffer if possible.
+void BufferedPrinter::make_room(size_t size) {
+    Option<size_t> last_newline = StringSlice(_buffer, _size).rfind('\n');
+    size_t line_end = last_newline.is_present() ? last_newline.unwrap() + 1 : 0;
+    if(line_end && _size - line_end + size <= _cap) {
+        _sink->print(StringSlice(_buffer, line_end));
+        memmove(_buffer, _buffer + line_end, _size - line_end);
+        _size -= line_end;
+    } else {
+        flush();
+    }
+}
+
+void BufferedPrinter::print(StringSlice string) {
+    if(_size + string.size() > _cap) {
+        make_room(string.size());
+        if(string.size() > _cap) {
+            // Too big to ever buffer
+            flush();
+            _sink->print(string);
+            return;
         }
     }
-};
+    memcpy(_buffer + _size, string.data(), string.size());
+    _size += string.size();
+    if(_policy == FlushPolicy::LINE && string.find('\n').is_present()) {
+        flush();
+    }
+}
+
+void BufferedPrinter::print(WideStringSlice string) {
+    size_t size = wide_to_utf8_length(string.data(), string.size());
+    if(_size + size > _cap) {
+        make_room(size);
+        if(size > _cap) {
+            flush();
+            _sink->print(string);
+            return;
+        }
+    }
+    wide_to_utf8(string.data(), string.size(), _buffer + _size);
+    _size += size;
+    if(_policy == FlushPolicy::LINE && string.find(L'\n').is_present()) {
+        flush();
+    }
+}
+
+// Longest prefix of the size characters at data that fits in room without splitting a character.
+static size_t fitting_prefix(const char* data, size_t size, size_t room) {
+    if(size <= room) return size;
+    size_t end = room;
+    // Back up over at most three continuation bytes to the start of the sequence
+    for(int i = 0; i < 3 && end && ((uint8_t)data[end] & 0xC0) == 0x80; i++) {
+        end--;
+    }
+    return end;
+}
 
-template<size_t N, StaticString<N> string>
-constexpr size_t take_static_string() {
-    return find_first_curlies(string.data).size();
+static size_t fitting_prefix(const wchar_t* data, size_t size, size_t room) {
+    if(size <= room) return size;
+    size_t end = room;
+    if(sizeof(wchar_t) == 2 && end && data[end] >= 0xDC00 && data[end] <= 0xDFFF) {
+        end--;
+    }
+    return end;
 }
 
+// Converts a chunk at a time into a buffer on the stack, until a chunk doesn't fit.
+template<typename To, typename From>
+static size_t convert_truncated(GenericStringSlice<From> string, To* out, size_t room) {
+    constexpr size_t CHUNK_SIZE = 64;
+    // A UTF-16 code unit takes at most three bytes of UTF-8 and a UTF-32 one at most four, while a byte of
+    // UTF-8 takes at most one code unit
+    To converted[CHUNK_SIZE * (sizeof(wchar_t) == 2 ? 3 : 4)];
+    size_t written = 0;
+    size_t i = 0;
+    while(i < string.size()) {
+        // Chunks end between characters too, so that none gets converted in two halves
+        size_t count = fitting_prefix(string.data() + i, string.size() - i, CHUNK_SIZE);
+
+        size_t converted_size;
+        if constexpr(std::same_as<To, char>) {
+            converted_size = wide_to_utf8(string.data() + i, count, converted);
+        } else {
+            converted_size = utf8_to_wide(string.data() + i, count, converted);
+        }
+        size_t fitting = fitting_prefix(converted, converted_size, room - written);
+        memcpy(out + written, converted, fitting * sizeof(To));
+        written += fitting;
+        if(fitting != converted_size) break;
+        i += count;
+    }
+    return written;
+}
+
+namespace impl {
+    size_t print_truncated(StringSlice string, char* out, size_t room) {
+        size_t size = fitting_prefix(string.data(), string.size(), room);
+        memcpy(out, string.data(), size);
+        return size;
+    }
 
+    size_t print_truncated(WideStringSlice string, wchar_t* out, size_t room) {
+        size_t size = fitting_prefix(string.data(), string.size(), room);
+        memcpy(out, string.data(), size * sizeof(wchar_t));
+        return size;
+    }
+
+    size_t print_truncated(WideStringSlice string, char* out, size_t room) {
+        return convert_truncated(string, out, room);
+    }
+
+    size_t print_truncated(StringSlice string, wchar_t* out, size_t room) {
+        return convert_truncated(string, out, room);
+    }
 };
 
-// void aah() {
-//     // constexpr impl::StaticString format_string = "Hello, {}. My name is {} and I like.\n";
-//     // // size_t num = impl::take_static_string<decltype(format_string)::num, format_string>();
-//     // constexpr 
-//     constexpr size_t size = [] {return impl::tokenize_format("Hello, {}. My name is {} and I like.\n").size();}();
-//     impl::Token tokens[size] = {};
-//     // static_assert(num == 0);
-// }
+#ifdef _WIN32
+void DebugPrinter::print(StringSlice string) {
+    OutputDebugStringA(string.c_str_or_copy());
+}
+
+void DebugPrinter::print(WideStringSlice string) {
+    OutputDebugStringW(string.c_str_or_copy());
+}
+#else
+// There's no debugger output channel, so it goes to stderr
+void DebugPrinter::print(StringSlice string) {
+    stderr_printer.print(string);
+}
+
+void DebugPrinter::print(WideStringSlice string) {
+    stderr_printer.print(string);
+}
+#endif
 
 };
 
@@ -87,10 +203,21 @@ void zw_display(const zw::Indentation& indentation) {
         zw_display(" ");
     }
 }
+void zw_display(zw::Hex hex) {
+    char buf[zw::MAX_HEX_CHARS];
+    zw_display(StringSlice(buf, zw::format_hex(hex.value, buf)));
+}
+void zw_display(zw::Binary binary) {
+    char buf[zw::MAX_BINARY_CHARS];
+    zw_display(StringSlice(buf, zw::format_binary(binary.value, buf)));
+}
 void zw_display(float val) {
-    char buf[512];
-    sprintf_s(buf, sizeof(buf), "%0.6f", val);
-    zw_display(buf);
+    char buf[zw::MAX_FLOAT_CHARS];
+    zw_display(StringSlice(buf, zw::format_float(val, buf)));
+}
+void zw_display(double val) {
+    char buf[zw::MAX_FLOAT_CHARS];
+    zw_display(StringSlice(buf, zw::format_float(val, buf)));
 }
 void zw_display(bool val) {
     if(val) {
@@ -4,48 +4,79 @@
 
 #include "string.h"
 #include "context.h"
+#include "format_string.h"
+#include "number_format.h"
 
-namespace zw { class Printer; };
+namespace zw { class Printer; struct Indentation; struct Hex; struct Binary; };
 
 ZW_DECLARE_CTX_VAR(zw::Printer*, printer);
 ZW_DECLARE_CTX_VAR(uint32_t, indent);
 
+// Format strings must be literals, which are checked against the number of arguments at compile time, or be
+// wrapped in zw::runtime_format().
+
 // Narrow strings
 template<typename... Ds>
-void zw_print(zw::StringSlice format, Ds&&... ds);
+void zw_print(zw::FormatString<sizeof...(Ds)> format, Ds&&... ds);
 
 template<typename... Ds>
-void zw_println(zw::StringSlice format, Ds&&... ds) {
+void zw_println(zw::FormatString<sizeof...(Ds)> format, Ds&&... ds) {
     zw_print(format, std::forward<Ds>(ds)...);
     zw_print("\n");
 }
 template<typename... Ds>
-zw::String zw_format(zw::StringSlice format, Ds&&... ds);
+zw::String zw_format(zw::FormatString<sizeof...(Ds)> format, Ds&&... ds);
 
 
 // Wide strings
 template<typename... Ds>
-void zw_print(zw::WideStringSlice format, Ds&&... ds);
+void zw_print(zw::WideFormatString<sizeof...(Ds)> format, Ds&&... ds);
 
 template<typename... Ds>
-void zw_println(zw::WideStringSlice format, Ds&&... ds) {
+void zw_println(zw::WideFormatString<sizeof...(Ds)> format, Ds&&... ds) {
     zw_print(format, std::forward<Ds>(ds)...);
-    zw_print("\n");
+    zw_print(L"\n");
 }
 template<typename... Ds>
-zw::WideString zw_format(zw::WideStringSlice format, Ds&&... ds);
+zw::WideString zw_format(zw::WideFormatString<sizeof...(Ds)> format, Ds&&... ds);
+
+// Display overloads for built-in and library types. zw_display() is called unqualified, so overloads for
+// classes in the global namespace are found by argument-dependent lookup even if they're declared after this
+// header; overloads for anything else have to be declared before the formatting functions are instantiated.
+void zw_display(zw::StringSlice string);
+void zw_display(zw::WideStringSlice string);
+inline void zw_display(const char* string) {
+    zw_display(zw::StringSlice(string));
+}
+inline void zw_display(const wchar_t* string) {
+    zw_display(zw::WideStringSlice(string));
+}
+void zw_display(const zw::Indentation& indentation);
+void zw_display(zw::Hex hex);
+void zw_display(zw::Binary binary);
+void zw_display(float val);
+void zw_display(double val);
+
+void zw_display(bool val);
+
+void zw_display(std::integral auto val) {
+    char buf[zw::MAX_INTEGER_CHARS];
+    zw_display(zw::StringSlice(buf, zw::format_integer(val, buf)));
+}
 
 namespace zw {
 
 template<typename T>
 concept Display = requires(const T& val) {
-    { ::zw_display(val) };
+    { zw_display(val) };
 };
 
 class Printer {
 public:
     virtual void print(StringSlice string) = 0;
     virtual void print(WideStringSlice string) = 0;
+    /// Makes sure everything printed so far has reached its final destination, e.g. by flushing a file.
+    virtual void sync() {}
 };
 
 class StdFilePrinter: public Printer {
@@ -54,6 +85,7 @@ public:
     StdFilePrinter(FILE* file) : file(file) {}
     void print(StringSlice string) override;
     void print(WideStringSlice string) override;
+    void sync() override;
 };
 
 class DebugPrinter: public Printer {
@@ -62,31 +94,62 @@ public:
     void print(WideStringSlice string) override;
 };
 
+/// Collects output in a buffer and passes it on to another printer in big pieces, so that each print doesn't
+/// pay for a call (and a lock, and possibly a system call) in the sink. Wide strings are converted to UTF-8.
+///
+/// The buffer is flushed when a print doesn't fit in it, when flush() is called, when the printer is
+/// destroyed, and with FlushPolicy::LINE also whenever a print contains a newline. Flushing on a full buffer
+/// only passes on complete lines while there are any, so as long as the sink takes each print under a lock,
+/// like StdFilePrinter does, lines from different threads never get mixed up.
+///
+/// A BufferedPrinter is not thread-safe: give each thread its own, which zw_set_ctx(printer, ...) does
+/// anyway since the context is per thread.
+class BufferedPrinter: public Printer {
+public:
+    enum class FlushPolicy {
+        FULL,
+        LINE,
+    };
+
+    static constexpr size_t DEFAULT_CAP = 64 * 1024;
+
+private:
+    Printer* _sink;
+    Allocator* _allocator;
+    char* _buffer;
+    size_t _size;
+    size_t _cap;
+    FlushPolicy _policy;
+
+    void make_room(size_t size);
+public:
+    explicit BufferedPrinter(Printer* sink, FlushPolicy policy = FlushPolicy::FULL, size_t cap = DEFAULT_CAP, Allocator* allocator = zw_get_ctx(allocator));
+    BufferedPrinter(const BufferedPrinter& other) = delete;
+    ~BufferedPrinter();
+
+    void print(StringSlice string) override;
+    void print(WideStringSlice string) override;
+
+    /// Passes on everything printed so far.
+    void flush();
+    void sync() override;
+};
+
 template<typename Char>
 class StringPrinter: public Printer {
     GenericString<Char> output;
 public:
+    StringPrinter() = default;
+    explicit StringPrinter(size_t reserve) {
+        output.reserve(reserve);
+    }
 
     void print(StringSlice string) override {
-        if constexpr(std::same_as<Char, char>) {
-            output.append(string);
-        } else {
-            using_temp_allocator(
-                WideString wide_string = string;
-            )
-            output.append(wide_string);
-        }
+        output.append(string);
     }
 
     void print(WideStringSlice string) override {
-        if constexpr(std::same_as<Char, wchar_t>) {
-            output.append(string);
-        } else {
-            using_temp_allocator(
-                String narrow_string = string;
-            )
-            output.append(narrow_string);
-        }
+        output.append(string);
     }
 
     GenericString<Char> flush() {
@@ -94,83 +157,130 @@ public:
     }
 };
 
-extern StdFilePrinter stdout_printer;
-extern StdFilePrinter stderr_printer;
-extern DebugPrinter debug_printer;
-
 namespace impl {
+    // Copy or convert as much of string as fits in room characters at out, but never half a character, i.e.
+    // part of a UTF-8 sequence or of a surrogate pair. Return how many characters were written.
+    size_t print_truncated(StringSlice string, char* out, size_t room);
+    size_t print_truncated(WideStringSlice string, char* out, size_t room);
+    size_t print_truncated(StringSlice string, wchar_t* out, size_t room);
+    size_t print_truncated(WideStringSlice string, wchar_t* out, size_t room);
+};
 
+/// Prints into a caller-provided buffer, without allocating. Output that doesn't fit is cut off at a
+/// character boundary, after which nothing more is written. Nothing is null-terminated.
 template<typename Char>
-bool print_until_first_curlies(GenericStringSlice<Char> format, size_t* cur_chunk_begin) {
-    enum class ParseState {
-        Normal,
-        SawOpenCurly,
-        SawCloseCurly,
-        End,
-    };
-    *cur_chunk_begin = 0;
-    ParseState state = ParseState::Normal;
-    for(auto i: format.indices()) {
-        switch(state) {
-            case ParseState::Normal: {
-                if(format[i] == '{') {
-                    state = ParseState::SawOpenCurly;
-                } else if(format[i] == '}') {
-                    state = ParseState::SawCloseCurly;
-                }
-                break;
+class FixedBufferPrinter: public Printer {
+    Char* _buffer;
+    size_t _cap;
+    size_t _size;
+    bool _is_truncated;
+
+    template<typename OtherChar>
+    void print_any(GenericStringSlice<OtherChar> string) {
+        if(_is_truncated) return;
+        size_t room = _cap - _size;
+        if constexpr(std::same_as<Char, OtherChar>) {
+            if(string.size() <= room) {
+                memcpy(_buffer + _size, string.data(), string.size() * sizeof(Char));
+                _size += string.size();
+                return;
             }
-
-            case ParseState::SawOpenCurly: {
-                if(format[i] == '{') {
-                    zw_get_ctx(printer)->print(format[Range(*cur_chunk_begin, i)]);
-                    *cur_chunk_begin = i + 1;
-                } else if(format[i] == '}') {
-                    zw_get_ctx(printer)->print(format[Range(*cur_chunk_begin, i-1)]);
-                    *cur_chunk_begin = i + 1;
-                    state = ParseState::End;
-                    goto END;
-                } else {
-                    assert(false && "Invalid character in format string, expected curly brace");
-                }
-                break;
+        } else if constexpr(std::same_as<Char, char>) {
+            if(wide_to_utf8_length(string.data(), string.size()) <= room) {
+                _size += wide_to_utf8(string.data(), string.size(), _buffer + _size);
+                return;
             }
-
-            case ParseState::SawCloseCurly: {
-                if(format[i] == '}') {
-                    zw_get_ctx(printer)->print(format[Range(*cur_chunk_begin, i-1)]);
-                    *cur_chunk_begin = i + 1;
-                } else {
-                    assert(false && "Invalid character in format string, expected curly brace");
-                }
-                break;
+        } else {
+            if(utf8_to_wide_length(string.data(), string.size()) <= room) {
+                _size += utf8_to_wide(string.data(), string.size(), _buffer + _size);
+                return;
             }
         }
+        _size += impl::print_truncated(string, _buffer + _size, room);
+        _is_truncated = true;
     }
-    END:
-    return state == ParseState::End;
-}
+public:
+    FixedBufferPrinter(Char* buffer, size_t cap) : _buffer(buffer), _cap(cap), _size(0), _is_truncated(false) {}
 
+    void print(StringSlice string) override { print_any(string); }
+    void print(WideStringSlice string) override { print_any(string); }
+
+    /// Number of characters written to the buffer.
+    size_t size() const { return _size; }
+    bool is_truncated() const { return _is_truncated; }
+};
+
+/// Counts the characters a StringPrinter<Char> would end up with, without storing them.
 template<typename Char>
-void print(GenericStringSlice<Char> format) {
-    zw_get_ctx(printer)->print(format);
-    size_t cur_chunk_begin = 0;
-    bool found_curlies = print_until_first_curlies(format, &cur_chunk_begin);
-    assert(!found_curlies && "Too few arguments passed to fmt function");
+class CountingPrinter: public Printer {
+    size_t _size = 0;
+public:
+    void print(StringSlice string) override {
+        if constexpr(std::same_as<Char, char>) {
+            _size += string.size();
+        } else {
+            _size += utf8_to_wide_length(string.data(), string.size());
+        }
+    }
+    void print(WideStringSlice string) override {
+        if constexpr(std::same_as<Char, char>) {
+            _size += wide_to_utf8_length(string.data(), string.size());
+        } else {
+            _size += string.size();
+        }
+    }
+
+    size_t size() const { return _size; }
+};
+
+struct FormatToResult {
+    /// Number of characters written.
+    size_t size;
+    /// Whether the output was cut off because it didn't fit.
+    bool is_truncated;
+};
+
+extern StdFilePrinter stdout_printer;
+extern StdFilePrinter stderr_printer;
+extern DebugPrinter debug_printer;
+
+namespace impl {
+
+// Prints a format string literal, collapsing its escaped braces.
+template<typename Char>
+void print_unescaped(Printer* printer, GenericStringSlice<Char> literal) {
+    const Char braces[] = {'{', '}'};
+    size_t begin = 0;
+    for(;;) {
+        size_t index = find_any_of(literal.data() + begin, literal.size() - begin, braces, 2);
+        if(index == NOT_FOUND) break;
+        // Keep the first brace of the pair and skip the second
+        printer->print(literal[Range(begin, begin + index + 1)]);
+        begin += index + 2;
+    }
+    if(begin < literal.size()) {
+        printer->print(literal[Range(begin, literal.size())]);
+    }
 }
 
-template<typename Char, typename D0, typename... Ds>
-void print(GenericStringSlice<Char> format, D0&& d0, Ds&&... ds) {
-    size_t cur_chunk_begin = 0;
-    bool found_curlies = impl::print_until_first_curlies(format, &cur_chunk_begin);
-    assert(found_curlies && "Too many arguments passed to fmt function");
-    ::zw_display(std::forward<D0>(d0));
-    if(cur_chunk_begin < format.size()) {
-        impl::print(format[Range(cur_chunk_begin, format.size())], std::forward<Ds>(ds)...);
-    } else if(cur_chunk_begin > format.size()) {
-        abort();
+template<typename Char, size_t NUM_ARGS>
+void print_literal(const BasicFormatString<Char, NUM_ARGS>& format, size_t index) {
+    GenericStringSlice<Char> literal = format.literal(index);
+    if(!literal.size()) return;
+    if(format.literal_has_escapes(index)) {
+        print_unescaped(zw_get_ctx(printer), literal);
+    } else {
+        zw_get_ctx(printer)->print(literal);
     }
 }
+
+template<typename Char, size_t NUM_ARGS, typename... Ds>
+void print(const BasicFormatString<Char, NUM_ARGS>& format, Ds&&... ds) {
+    static_assert(sizeof...(Ds) == NUM_ARGS);
+    size_t index = 0;
+    ((print_literal(format, index++), zw_display(std::forward<Ds>(ds))), ...);
+    print_literal(format, NUM_ARGS);
+}
 };
 
 struct Indentation {
@@ -178,82 +288,98 @@ struct Indentation {
     explicit Indentation(uint32_t amount = zw_get_ctx(indent)) : amount(amount) {}
 };
 
+/// Displays an integer in lower-case hexadecimal, e.g. zw_print("{}", zw::Hex(255)) prints "ff". Negative
+/// values are shown in two's complement.
+struct Hex {
+    uint64_t value;
+    template<std::integral T>
+    explicit Hex(T value) : value((std::make_unsigned_t<T>)value) {}
+};
+
+/// Displays an integer in binary, like Hex.
+struct Binary {
+    uint64_t value;
+    template<std::integral T>
+    explicit Binary(T value) : value((std::make_unsigned_t<T>)value) {}
+};
+
 };
 
 // Narrow strings
 template<typename... Ds>
-void zw_print(zw::StringSlice format, Ds&&... ds) {
+void zw_print(zw::FormatString<sizeof...(Ds)> format, Ds&&... ds) {
     zw::impl::print(format, std::forward<Ds>(ds)...);
 }
 
+/// Exact length of what zw_format would return.
 template<typename... Ds>
-zw::String zw_format(zw::StringSlice format, Ds&&... ds) {
-    zw::StringPrinter<char> printer;
+size_t zw_formatted_size(zw::FormatString<sizeof...(Ds)> format, const Ds&... ds) {
+    zw::CountingPrinter<char> printer;
+    zw_set_ctx(printer, &printer);
+    zw_print(format, ds...);
+    return printer.size();
+}
+
+/// Formats into buffer without allocating, writing at most cap characters.
+template<typename... Ds>
+zw::FormatToResult zw_format_to(char* buffer, size_t cap, zw::FormatString<sizeof...(Ds)> format, Ds&&... ds) {
+    zw::FixedBufferPrinter<char> printer(buffer, cap);
+    zw_set_ctx(printer, &printer);
+    zw_print(format, std::forward<Ds>(ds)...);
+    return {printer.size(), printer.is_truncated()};
+}
+
+/// Formats twice: once to measure, so that the result can be allocated at its exact size, and once for real.
+template<typename... Ds>
+zw::String zw_format(zw::FormatString<sizeof...(Ds)> format, Ds&&... ds) {
+    zw::StringPrinter<char> printer(zw_formatted_size(format, ds...));
     zw_set_ctx(printer, &printer);
     zw_print(format, std::forward<Ds>(ds)...);
     return printer.flush();
 }
 
 template<typename... Ds>
-zw::NoDestruct<zw::String> zw_temp_format(zw::StringSlice format, Ds&&... ds) {
+zw::NoDestruct<zw::String> zw_temp_format(zw::FormatString<sizeof...(Ds)> format, Ds&&... ds) {
     use_temp_allocator();
     return zw_format(format, std::forward<Ds>(ds)...);
 }
 
 // Wide strings
 template<typename... Ds>
-void zw_print(zw::WideStringSlice format, Ds&&... ds) {
+void zw_print(zw::WideFormatString<sizeof...(Ds)> format, Ds&&... ds) {
     zw::impl::print(format, std::forward<Ds>(ds)...);
 }
 
 template<typename... Ds>
-zw::WideString zw_format(zw::WideStringSlice format, Ds&&... ds) {
-    zw::StringPrinter<wchar_t> printer;
+size_t zw_formatted_size(zw::WideFormatString<sizeof...(Ds)> format, const Ds&... ds) {
+    zw::CountingPrinter<wchar_t> printer;
     zw_set_ctx(printer, &printer);
-    zw_print(format, std::forward<Ds>(ds)...);
-    return printer.flush();
+    zw_print(format, ds...);
+    return printer.size();
 }
 
 template<typename... Ds>
-zw::NoDestruct<zw::WideString> zw_temp_format(zw::WideStringSlice format, Ds&&... ds) {
-    use_temp_allocator();
-    return zw_format(format, std::forward<Ds>(ds)...);
-}
-
-void zw_display(zw::StringSlice string);
-void zw_display(zw::WideStringSlice string);
-inline void zw_display(const char* string) {
-    zw_display(zw::StringSlice(string));
-}
-inline void zw_display(const wchar_t* string) {
-    zw_display(zw::WideStringSlice(string));
+zw::FormatToResult zw_format_to(wchar_t* buffer, size_t cap, zw::WideFormatString<sizeof...(Ds)> format, Ds&&... ds) {
+    zw::FixedBufferPrinter<wchar_t> printer(buffer, cap);
+    zw_set_ctx(printer, &printer);
+    zw_print(format, std::forward<Ds>(ds)...);
+    return {printer.size(), printer.is_truncated()};
 }
-void zw_display(const zw::Indentation& indentation);
-void zw_display(float val);
-
-void zw_display(bool val);
 
-void zw_display(std::unsigned_integral auto val) {
-    char buf[512];
-    if constexpr(sizeof(val) <= 4) {
-        sprintf_s(buf, sizeof(buf), "%u", val);
-    } else {
-        sprintf_s(buf, sizeof(buf), "%llu", val);
-    }
-    zw_display(buf);
+template<typename... Ds>
+zw::WideString zw_format(zw::WideFormatString<sizeof...(Ds)> format, Ds&&... ds) {
+    zw::StringPrinter<wchar_t> printer(zw_formatted_size(format, ds...));
+    zw_set_ctx(printer, &printer);
+    zw_print(format, std::forward<Ds>(ds)...);
+    return printer.flush();
 }
 
-void zw_display(std::signed_integral auto val) {
-    char buf[512];
-    if constexpr(sizeof(val) <= 4) {
-        sprintf_s(buf, sizeof(buf), "%d", val);
-    } else {
-        sprintf_s(buf, sizeof(buf), "%lld", val);
-    }
-    zw_display(buf);
+template<typename... Ds>
+zw::NoDestruct<zw::WideString> zw_temp_format(zw::WideFormatString<sizeof...(Ds)> format, Ds&&... ds) {
+    use_temp_allocator();
+    return zw_format(format, std::forward<Ds>(ds)...);
 }
 
-
 template<zw::Display D>
 void zw_display(const zw::Array<D>& array) {
     if(array.size() < 2) {
@@ -289,7 +415,7 @@ void zw_display(const zw::NoDestruct<D>& object) {
 #define ZW_DISPLAY_ENUM_BEGIN() switch(val) {
 #define ZW_DISPLAY_ENUM_END(name) \
     default: \
-        ::zw_print("{Unknown " #name " value}"); \
+        ::zw_print("{{Unknown " #name " value}}"); \
         break; \
     }
 #define ZW_DISPLAY_ENUM_CASE(name) \
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+
+#include "range.h"
+#include "string.h"
+
+// Format strings are split into their literal text and argument slots ("{}") when they are constructed.
+// Literals construct them in a consteval constructor, so a malformed format string, or one whose number of
+// slots doesn't match the number of arguments, is a compile error, and printing just walks the precomputed
+// segments. "{{" and "}}" stand for literal braces.
+
+namespace zw {
+
+namespace impl {
+    // Deliberately not constexpr: calling one of these while parsing at compile time makes the program
+    // ill-formed, and the compiler's error names the function, and so the problem.
+    void format_string_has_more_slots_than_arguments();
+    void format_string_has_fewer_slots_than_arguments();
+    void format_string_has_unescaped_brace();
+
+    enum class FormatStringError {
+        NONE,
+        MORE_SLOTS_THAN_ARGUMENTS,
+        FEWER_SLOTS_THAN_ARGUMENTS,
+        UNESCAPED_BRACE,
+    };
+
+    // A run of literal text in a format string, [begin, end) in the original string including both
+    // characters of each escaped brace
+    struct FormatLiteral {
+        uint32_t begin;
+        uint32_t end;
+        uint32_t num_escapes;
+    };
+
+    // Fills in the num_slots + 1 literals around the slots of format.
+    template<typename Char>
+    constexpr FormatStringError parse_format_string(GenericStringSlice<Char> format, FormatLiteral* literals, size_t num_slots) {
+        size_t slot = 0;
+        FormatLiteral literal = {0, 0, 0};
+        size_t i = 0;
+        while(i < format.size()) {
+            Char c = format[i];
+            if(c == '{' && i + 1 < format.size() && format[i + 1] == '}') {
+                if(slot == num_slots) return FormatStringError::MORE_SLOTS_THAN_ARGUMENTS;
+                literal.end = (uint32_t)i;
+                literals[slot++] = literal;
+                i += 2;
+                literal = {(uint32_t)i, (uint32_t)i, 0};
+            } else if(c == '{' || c == '}') {
+                // A lone brace, rather than {}, {{ or }}
+                if(i + 1 == format.size() || format[i + 1] != c) return FormatStringError::UNESCAPED_BRACE;
+                literal.num_escapes++;
+                i += 2;
+            } else {
+                i++;
+            }
+        }
+        if(slot != num_slots) return FormatStringError::FEWER_SLOTS_THAN_ARGUMENTS;
+        literal.end = (uint32_t)i;
+        literals[slot] = literal;
+        return FormatStringError::NONE;
+    }
+};
+
+/// Wraps a format string only known at runtime, which is then checked by assertions instead of at compile time.
+template<typename Char>
+struct RuntimeFormat {
+    GenericStringSlice<Char> string;
+};
+
+inline RuntimeFormat<char> runtime_format(StringSlice string) { return {string}; }
+inline RuntimeFormat<wchar_t> runtime_format(WideStringSlice string) { return {string}; }
+
+/// A format string for NUM_ARGS arguments, parsed once when it's constructed.
+template<typename Char, size_t NUM_ARGS>
+class BasicFormatString {
+    GenericStringSlice<Char> _string;
+    impl::FormatLiteral _literals[NUM_ARGS + 1];
+public:
+    consteval BasicFormatString(const Char* string) : BasicFormatString(GenericStringSlice<Char>(string)) {}
+    consteval BasicFormatString(GenericStringSlice<Char> string) : _string(string), _literals() {
+        switch(impl::parse_format_string(string, _literals, NUM_ARGS)) {
+            case impl::FormatStringError::NONE: break;
+            case impl::FormatStringError::MORE_SLOTS_THAN_ARGUMENTS: impl::format_string_has_more_slots_than_arguments(); break;
+            case impl::FormatStringError::FEWER_SLOTS_THAN_ARGUMENTS: impl::format_string_has_fewer_slots_than_arguments(); break;
+            case impl::FormatStringError::UNESCAPED_BRACE: impl::format_string_has_unescaped_brace(); break;
+        }
+    }
+    BasicFormatString(RuntimeFormat<Char> format) : _string(format.string), _literals() {
+        impl::FormatStringError error = impl::parse_format_string(format.string, _literals, NUM_ARGS);
+        assert(error == impl::FormatStringError::NONE && "invalid format string, or wrong number of arguments for it");
+    }
+
+    GenericStringSlice<Char> string() const { return _string; }
+
+    /// The literal text before argument index, or after the last argument for index NUM_ARGS, with escaped
+    /// braces still doubled.
+    GenericStringSlice<Char> literal(size_t index) const {
+        return _string[Range(_literals[index].begin, _literals[index].end)];
+    }
+    bool literal_has_escapes(size_t index) const { return _literals[index].num_escapes != 0; }
+};
+
+template<size_t NUM_ARGS>
+using FormatString = BasicFormatString<char, NUM_ARGS>;
+template<size_t NUM_ARGS>
+using WideFormatString = BasicFormatString<wchar_t, NUM_ARGS>;
+
+};
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include "array.h"
+#include "misc.h"
+#include "string.h"
+
+// 64-bit non-cryptographic hashing. Bytes are hashed with wyhash (final version 4), which reads keys of up to
+// 16 bytes with a couple of overlapping loads and longer keys 48 bytes per iteration, folding everything
+// with 64x64->128-bit multiplies. Hashes are not stable across versions of the library, so don't persist them.
+
+namespace zw {
+
+namespace impl {
+    // splitmix64 finalizer
+    inline uint64_t hash_mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return x;
+    }
+
+    constexpr uint64_t HASH_SECRET[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+    // Full 128-bit product of a and b, low half in a and high half in b
+    inline void hash_multiply(uint64_t* a, uint64_t* b) {
+        *a = multiply_128(*a, *b, b);
+    }
+
+    inline uint64_t hash_fold(uint64_t a, uint64_t b) {
+        hash_multiply(&a, &b);
+        return a ^ b;
+    }
+
+    inline uint64_t hash_read8(const uint8_t* p) {
+        uint64_t value;
+        memcpy(&value, p, 8);
+        return value;
+    }
+
+    inline uint64_t hash_read4(const uint8_t* p) {
+        uint32_t value;
+        memcpy(&value, p, 4);
+        return value;
+    }
+
+    inline uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0) {
+        const uint8_t* p = (const uint8_t*)data;
+        const uint64_t* secret = HASH_SECRET;
+        seed ^= hash_fold(seed ^ secret[0], secret[1]);
+        uint64_t a, b;
+        if(size <= 16) {
+            if(size >= 4) {
+                // Two pairs of possibly overlapping 4-byte loads cover the whole key
+                size_t offset = (size >> 3) << 2;
+                a = (hash_read4(p) << 32) | hash_read4(p + offset);
+                b = (hash_read4(p + size - 4) << 32) | hash_read4(p + size - 4 - offset);
+            } else if(size > 0) {
+                a = ((uint64_t)p[0] << 16) | ((uint64_t)p[size >> 1] << 8) | p[size - 1];
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            size_t i = size;
+            if(i > 48) {
+                // Three independent lanes, so that the multiplies overlap
+                uint64_t seed1 = seed, seed2 = seed;
+                do {
+                    seed = hash_fold(hash_read8(p) ^ secret[1], hash_read8(p + 8) ^ seed);
+                    seed1 = hash_fold(hash_read8(p + 16) ^ secret[2], hash_read8(p + 24) ^ seed1);
+                    seed2 = hash_fold(hash_read8(p + 32) ^ secret[3], hash_read8(p + 40) ^ seed2);
+                    p += 48;
+                    i -= 48;
+                } while(i > 48);
+                seed ^= seed1 ^ seed2;
+            }
+            while(i > 16) {
+                seed = hash_fold(hash_read8(p) ^ secret[1], hash_read8(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = hash_read8(p + i - 16);
+            b = hash_read8(p + i - 8);
+        }
+        a ^= secret[1];
+        b ^= seed;
+        hash_multiply(&a, &b);
+        return hash_fold(a ^ secret[0] ^ size, b ^ secret[1]);
+    }
+};
+
+/// Types whose bytes are their identity, so that they can be hashed as raw memory.
+template<typename T>
+concept HashableBytes = std::is_trivially_copyable_v<T> && std::has_unique_object_representations_v<T>;
+
+template<typename Char>
+uint64_t hash(GenericStringSlice<Char> string) {
+    return impl::hash_bytes(string.data(), string.size() * sizeof(Char));
+}
+
+template<typename Char>
+uint64_t hash(const GenericString<Char>& string) {
+    return hash(string.as_slice());
+}
+
+/// Integers, enums and pointers are mixed directly; other trivially copyable types without padding are
+/// hashed as bytes.
+template<HashableBytes T>
+uint64_t hash(const T& value) {
+    if constexpr(std::is_integral_v<T> || std::is_enum_v<T>) {
+        return impl::hash_mix((uint64_t)value);
+    } else if constexpr(std::is_pointer_v<T>) {
+        return impl::hash_mix((uint64_t)(uintptr_t)value);
+    } else {
+        return impl::hash_bytes(&value, sizeof(T));
+    }
+}
+
+/// Streaming hasher for composite keys. Feed it the parts of the key in order and call finish().
+class HashBuilder {
+    uint64_t _state;
+public:
+    explicit HashBuilder(uint64_t seed = 0) : _state(seed) {}
+
+    HashBuilder& add_bytes(const void* data, size_t size) {
+        _state = impl::hash_bytes(data, size, _state);
+        return *this;
+    }
+
+    template<typename T>
+    HashBuilder& add(const T& value) {
+        _state = impl::hash_fold(_state ^ hash(value), impl::HASH_SECRET[1]);
+        return *this;
+    }
+
+    uint64_t finish() const { return impl::hash_mix(_state); }
+};
+
+/// Arrays of padding-free trivially copyable elements are hashed as one block of memory. Others hash
+/// each element in turn.
+template<typename T>
+uint64_t hash(const Array<T>& array) {
+    if constexpr(HashableBytes<T>) {
+        return impl::hash_bytes(array.data(), array.size() * sizeof(T));
+    } else {
+        HashBuilder builder(array.size());
+        for(const T& element: array.iter()) {
+            builder.add(element);
+        }
+        return builder.finish();
+    }
+}
+
+/// Hash that agrees with is_equal_to_ignoring_case(): strings that compare equal ignoring case hash the same.
+template<typename Char>
+uint64_t hash_ignoring_case(GenericStringSlice<Char> string) {
+    // Lower a chunk at a time into a buffer, chaining each chunk's hash into the seed of the next
+    constexpr size_t CHUNK_SIZE = 128;
+    Char lowered[CHUNK_SIZE];
+    uint64_t result = string.size();
+    const Char* data = string.data();
+    size_t remaining = string.size();
+    if(!remaining) {
+        // Hashed as one empty chunk
+        return impl::hash_bytes(data, 0, result);
+    }
+    do {
+        size_t count = remaining < CHUNK_SIZE ? remaining : CHUNK_SIZE;
+        for(size_t i = 0; i < count; i++) {
+            Char c = data[i];
+            if constexpr(sizeof(Char) == 1) {
+                lowered[i] = (c & 0x80) ? priv::to_lower(c) : impl::ascii_to_lower(c);
+            } else {
+                lowered[i] = priv::to_lower(c);
+            }
+        }
+        result = impl::hash_bytes(lowered, count * sizeof(Char), result);
+        data += count;
+        remaining -= count;
+    } while(remaining);
+    return result;
+}
+
+};
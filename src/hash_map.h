@@ -0,0 +1,520 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <bit>
+#include <type_traits>
+#include <utility>
+
+#include "macros.h"
+#include "alloc.h"
+#include "misc.h"
+#include "array.h"
+#include "option.h"
+#include "string.h"
+#include "hash.h"
+
+#ifdef ZW_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace zw {
+
+template<typename K>
+struct DefaultHasher {
+    static uint64_t hash(const K& key) {
+        static_assert(HashableBytes<K>, "No default hash for this type, pass a Hasher to the container");
+        return zw::hash(key);
+    }
+};
+
+// Strings hash through their slice, so that a String-keyed container can be queried with a StringSlice.
+template<typename Char>
+struct DefaultHasher<GenericString<Char>> {
+    static uint64_t hash(GenericStringSlice<Char> key) {
+        return zw::hash(key);
+    }
+};
+
+template<typename Char>
+struct DefaultHasher<GenericStringSlice<Char>>: DefaultHasher<GenericString<Char>> {};
+
+template<typename K, typename V>
+struct HashMapEntry {
+    K key;
+    V value;
+};
+
+namespace impl {
+
+// Control bytes: a full slot stores the low 7 bits of its hash (H2), so its top bit is clear.
+// Empty and deleted slots both have the top bit set.
+constexpr int8_t CTRL_EMPTY = -128;
+constexpr int8_t CTRL_DELETED = -2;
+constexpr size_t HASH_GROUP_WIDTH = 16;
+
+// A group of 16 control bytes that can be matched against in one go. Bit i of each returned mask
+// corresponds to control byte i of the group.
+struct HashGroup {
+#ifdef ZW_SSE2
+    __m128i ctrl;
+
+    explicit HashGroup(const int8_t* pos) : ctrl(_mm_load_si128((const __m128i*)pos)) {}
+
+    uint32_t match(int8_t h2) const {
+        return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+    }
+    uint32_t match_empty_or_deleted() const {
+        return (uint32_t)_mm_movemask_epi8(ctrl);
+    }
+#else
+    const int8_t* ctrl;
+
+    explicit HashGroup(const int8_t* pos) : ctrl(pos) {}
+
+    uint32_t match(int8_t h2) const {
+        uint32_t mask = 0;
+        for(uint32_t i = 0; i < HASH_GROUP_WIDTH; i++) {
+            mask |= (uint32_t)(ctrl[i] == h2) << i;
+        }
+        return mask;
+    }
+    uint32_t match_empty_or_deleted() const {
+        uint32_t mask = 0;
+        for(uint32_t i = 0; i < HASH_GROUP_WIDTH; i++) {
+            mask |= (uint32_t)(ctrl[i] < 0) << i;
+        }
+        return mask;
+    }
+#endif
+    uint32_t match_empty() const { return match(CTRL_EMPTY); }
+};
+
+template<typename T>
+const T& slot_key(const T& slot) { return slot; }
+
+template<typename K, typename V>
+const K& slot_key(const HashMapEntry<K, V>& entry) { return entry.key; }
+
+template<typename Slot, typename Ref>
+class HashTableIterator {
+    const int8_t* ctrl;
+    Slot* slot;
+    Slot* end;
+
+    void skip_to_full() {
+        while(slot != end && *ctrl < 0) {
+            ++ctrl;
+            ++slot;
+        }
+    }
+public:
+    using Element = Ref;
+
+    HashTableIterator(const int8_t* ctrl, Slot* slot, Slot* end) : ctrl(ctrl), slot(slot), end(end) {
+        skip_to_full();
+    }
+
+    HashTableIterator<Slot, Ref>& operator++() {
+        ++ctrl;
+        ++slot;
+        skip_to_full();
+        return *this;
+    }
+
+    bool operator==(const HashTableIterator<Slot, Ref>& other) const { return slot == other.slot; }
+    bool operator!=(const HashTableIterator<Slot, Ref>& other) const { return slot != other.slot; }
+    Ref operator*() { return *slot; }
+};
+
+template<typename Slot, typename Ref>
+class HashTableIterable: public Iterable<HashTableIterable<Slot, Ref>> {
+    const int8_t* ctrl;
+    Slot* slots;
+    size_t cap;
+
+public:
+    using Iterator = HashTableIterator<Slot, Ref>;
+
+    HashTableIterable(const int8_t* ctrl, Slot* slots, size_t cap) : ctrl(ctrl), slots(slots), cap(cap) {}
+    Iterator begin() const { return Iterator(ctrl, slots, slots + cap); }
+    Iterator end() const { return Iterator(ctrl + cap, slots + cap, slots + cap); }
+};
+
+// Open-addressing table in the style of SwissTable. The control bytes and the slots live in one
+// allocation from the context allocator; probing walks 16-slot groups with triangular steps, which
+// visits every group exactly once since the number of groups is a power of two.
+template<typename Slot, typename Hasher>
+class HashTable: ZwObject {
+    int8_t* _ctrl = nullptr;
+    Slot* _slots = nullptr;
+    size_t _size = 0;
+    size_t _cap = 0;
+    size_t _growth_left = 0;
+
+    static size_t max_load(size_t cap) { return cap - cap / 8; }
+
+    static size_t slots_offset(size_t cap) { return nearest_multiple_of(cap, alignof(Slot)); }
+    static size_t allocation_alignment() { return alignof(Slot) > HASH_GROUP_WIDTH ? alignof(Slot) : HASH_GROUP_WIDTH; }
+
+    static int8_t h2(uint64_t hash) { return (int8_t)(hash & 0x7F); }
+    size_t first_group(uint64_t hash) const { return (size_t)(hash >> 7) & (_cap / HASH_GROUP_WIDTH - 1); }
+    size_t next_group(size_t group, size_t step) const { return (group + step) & (_cap / HASH_GROUP_WIDTH - 1); }
+
+    void allocate(size_t cap) {
+        assert(cap >= HASH_GROUP_WIDTH && (cap & (cap - 1)) == 0);
+        uint8_t* memory = (uint8_t*)zw_alloc(slots_offset(cap) + sizeof(Slot) * cap, allocation_alignment());
+        assert(memory && "allocator out of memory");
+        _ctrl = (int8_t*)memory;
+        _slots = (Slot*)(memory + slots_offset(cap));
+        _cap = cap;
+        memset(_ctrl, (uint8_t)CTRL_EMPTY, cap);
+        _growth_left = max_load(cap) - _size;
+    }
+
+    void destroy_slots() {
+        if constexpr(!std::is_trivially_destructible_v<Slot>) {
+            for(auto i: Range(_cap)) {
+                if(_ctrl[i] >= 0) {
+                    _slots[i].~Slot();
+                }
+            }
+        }
+    }
+
+    // Finds the first empty or deleted slot on the probe sequence for hash.
+    size_t find_insert_position(uint64_t hash) const {
+        size_t group = first_group(hash);
+        for(size_t step = 1;; step++) {
+            uint32_t mask = HashGroup(_ctrl + group * HASH_GROUP_WIDTH).match_empty_or_deleted();
+            if(mask) {
+                return group * HASH_GROUP_WIDTH + std::countr_zero(mask);
+            }
+            group = next_group(group, step);
+            assert(step <= _cap / HASH_GROUP_WIDTH && "hash table has no free slots");
+        }
+    }
+
+    // Looks for key along the probe sequence for hash. If FIND_INSERT_POSITION, also sets *insert_position to
+    // the first empty or deleted slot on the way, which is where find_insert_position() would put the key.
+    template<bool FIND_INSERT_POSITION, typename Q>
+    Slot* probe(const Q& key, uint64_t hash, size_t* insert_position) const {
+        int8_t tag = h2(hash);
+        size_t group = first_group(hash);
+        bool found_insert_position = false;
+        for(size_t step = 1; step <= _cap / HASH_GROUP_WIDTH; step++) {
+            HashGroup g(_ctrl + group * HASH_GROUP_WIDTH);
+            for(uint32_t mask = g.match(tag); mask; mask &= mask - 1) {
+                size_t index = group * HASH_GROUP_WIDTH + std::countr_zero(mask);
+                if(slot_key(_slots[index]) == key) {
+                    return &_slots[index];
+                }
+            }
+            if constexpr(FIND_INSERT_POSITION) {
+                if(!found_insert_position) {
+                    if(uint32_t mask = g.match_empty_or_deleted()) {
+                        *insert_position = group * HASH_GROUP_WIDTH + std::countr_zero(mask);
+                        found_insert_position = true;
+                    }
+                }
+            }
+            if(g.match_empty()) {
+                return nullptr;
+            }
+            group = next_group(group, step);
+        }
+        return nullptr;
+    }
+
+    void resize(size_t new_cap) {
+        int8_t* old_ctrl = _ctrl;
+        Slot* old_slots = _slots;
+        size_t old_cap = _cap;
+
+        allocate(new_cap);
+        for(auto i: Range(old_cap)) {
+            if(old_ctrl[i] >= 0) {
+                uint64_t hash = Hasher::hash(slot_key(old_slots[i]));
+                size_t index = find_insert_position(hash);
+                _ctrl[index] = h2(hash);
+                new(&_slots[index]) Slot(std::move(old_slots[i]));
+                old_slots[i].~Slot();
+            }
+        }
+        if(old_ctrl) {
+            zw_free(old_ctrl);
+        }
+    }
+
+    void make_room() {
+        if(_growth_left) return;
+
+        if(!_cap) {
+            resize(HASH_GROUP_WIDTH);
+        } else if(_size <= max_load(_cap) / 2) {
+            // Mostly tombstones; rebuilding at the same capacity is enough to reclaim them.
+            resize(_cap);
+        } else {
+            resize(_cap * 2);
+        }
+    }
+
+public:
+    HashTable() = default;
+    HashTable(const HashTable<Slot, Hasher>& other) : ZwObject(other) {
+        if(!other._cap) return;
+
+        _size = other._size;
+        allocate(other._cap);
+        _growth_left = other._growth_left;
+        memcpy(_ctrl, other._ctrl, _cap);
+        if constexpr(std::is_trivially_copyable_v<Slot>) {
+            memcpy(_slots, other._slots, sizeof(Slot) * _cap);
+        } else {
+            for(auto i: Range(_cap)) {
+                if(_ctrl[i] >= 0) {
+                    new(&_slots[i]) Slot(other._slots[i]);
+                }
+            }
+        }
+    }
+    HashTable(HashTable<Slot, Hasher>&& other) noexcept {
+        swap(*this, other);
+    }
+
+    HashTable<Slot, Hasher>& operator=(const HashTable<Slot, Hasher>& other) {
+        if(this != &other) {
+            HashTable<Slot, Hasher> temp = other;
+            swap(*this, temp);
+        }
+        return *this;
+    }
+
+    HashTable<Slot, Hasher>& operator=(HashTable<Slot, Hasher>&& other) {
+        if(this != &other) {
+            HashTable<Slot, Hasher> temp = std::move(other);
+            swap(*this, temp);
+        }
+        return *this;
+    }
+
+    ~HashTable() {
+        if(_ctrl) {
+            destroy_slots();
+            zw_free(_ctrl);
+        }
+    }
+
+    size_t size() const { return _size; }
+    size_t cap() const { return _cap; }
+
+    template<typename Q>
+    Slot* find(const Q& key) const {
+        if(!_size) return nullptr;
+
+        return find(key, Hasher::hash(key));
+    }
+    /// Like find(key), for when the key's hash is already known. hash must be Hasher::hash(key).
+    template<typename Q>
+    Slot* find(const Q& key, uint64_t hash) const {
+        return probe<false>(key, hash, nullptr);
+    }
+
+    // Returns the slot holding key if there is one. Otherwise claims a slot for it, sets *inserted
+    // and returns the claimed slot uninitialized; the caller must construct a Slot in it.
+    template<typename Q>
+    Slot* find_or_prepare_insert(const Q& key, bool* inserted) {
+        // The key is hashed once, and the probe for it also finds where it would go
+        uint64_t hash = Hasher::hash(key);
+        size_t index = 0;
+        if(Slot* slot = probe<true>(key, hash, &index)) {
+            *inserted = false;
+            return slot;
+        }
+
+        if(!_cap || (_ctrl[index] == CTRL_EMPTY && !_growth_left)) {
+            make_room();
+            index = find_insert_position(hash);
+        }
+        if(_ctrl[index] == CTRL_EMPTY) {
+            _growth_left--;
+        }
+        _ctrl[index] = h2(hash);
+        _size++;
+        *inserted = true;
+        return &_slots[index];
+    }
+
+    // Destroys the slot, which must have come from find() on this table.
+    void erase(Slot* slot) {
+        size_t index = slot - _slots;
+        assert(index < _cap && _ctrl[index] >= 0);
+        slot->~Slot();
+        _size--;
+
+        // If this group still has an empty slot, no probe sequence has ever continued past it,
+        // so the slot can go straight back to being empty instead of leaving a tombstone.
+        if(HashGroup(_ctrl + (index & ~(HASH_GROUP_WIDTH - 1))).match_empty()) {
+            _ctrl[index] = CTRL_EMPTY;
+            _growth_left++;
+        } else {
+            _ctrl[index] = CTRL_DELETED;
+        }
+    }
+
+    void clear() {
+        if(!_cap) return;
+
+        destroy_slots();
+        memset(_ctrl, (uint8_t)CTRL_EMPTY, _cap);
+        _size = 0;
+        _growth_left = max_load(_cap);
+    }
+
+    void reserve(size_t min_size) {
+        if(min_size <= _size + _growth_left) return;
+
+        size_t new_cap = _cap ? _cap : HASH_GROUP_WIDTH;
+        while(max_load(new_cap) < min_size) {
+            new_cap *= 2;
+        }
+        resize(new_cap);
+    }
+
+    HashTableIterable<const Slot, const Slot&> iter() const { return {_ctrl, _slots, _cap}; }
+    HashTableIterable<Slot, Slot&> iter_mut() { return {_ctrl, _slots, _cap}; }
+
+    friend void swap(HashTable<Slot, Hasher>& left, HashTable<Slot, Hasher>& right) {
+        std::swap(left._ctrl, right._ctrl);
+        std::swap(left._slots, right._slots);
+        std::swap(left._size, right._size);
+        std::swap(left._cap, right._cap);
+        std::swap(left._growth_left, right._growth_left);
+    }
+};
+
+};
+
+/// Unordered map with flat, open-addressed storage from the context allocator.
+/// Lookups are templated on the query type, so e.g. a HashMap<String, V> can be queried with a StringSlice
+/// without building a String; the Hasher must hash both types identically.
+template<typename K, typename V, typename Hasher = DefaultHasher<K>>
+class HashMap {
+    using Entry = HashMapEntry<K, V>;
+    impl::HashTable<Entry, Hasher> table;
+public:
+    size_t size() const { return table.size(); }
+    size_t cap() const { return table.cap(); }
+    bool is_empty() const { return table.size() == 0; }
+
+    void reserve(size_t min_size) { table.reserve(min_size); }
+    void clear() { table.clear(); }
+
+    /// Returns true if the key was newly inserted, or false if it was already present, in which case
+    /// the existing value is replaced.
+    bool insert(K key, V value) {
+        bool inserted;
+        Entry* entry = table.find_or_prepare_insert(key, &inserted);
+        if(inserted) {
+            new(entry) Entry { std::move(key), std::move(value) };
+        } else {
+            entry->value = std::move(value);
+        }
+        return inserted;
+    }
+
+    /// Returns the value for key, inserting a default-constructed one first if it isn't present.
+    V& get_or_insert(K key) requires std::default_initializable<V> {
+        bool inserted;
+        Entry* entry = table.find_or_prepare_insert(key, &inserted);
+        if(inserted) {
+            new(entry) Entry { std::move(key), V() };
+        }
+        return entry->value;
+    }
+
+    template<typename Q>
+    Option<const V*> get(const Q& key) const {
+        if(const Entry* entry = table.find(key)) {
+            return &entry->value;
+        }
+        return {};
+    }
+
+    template<typename Q>
+    Option<V*> get(const Q& key) {
+        if(Entry* entry = table.find(key)) {
+            return &entry->value;
+        }
+        return {};
+    }
+
+    template<typename Q>
+    bool contains(const Q& key) const {
+        return table.find(key) != nullptr;
+    }
+
+    template<typename Q>
+    bool remove(const Q& key) {
+        if(Entry* entry = table.find(key)) {
+            table.erase(entry);
+            return true;
+        }
+        return false;
+    }
+
+    /// Removes key from the map and moves its value out.
+    template<typename Q>
+    Option<V> take(const Q& key) {
+        if(Entry* entry = table.find(key)) {
+            Option<V> value = std::move(entry->value);
+            table.erase(entry);
+            return value;
+        }
+        return {};
+    }
+
+    /// Iterates over HashMapEntry<K, V> in unspecified order. Keys must not be modified through iter_mut().
+    auto iter() const { return table.iter(); }
+    auto iter_mut() { return table.iter_mut(); }
+};
+
+template<typename K, typename Hasher = DefaultHasher<K>>
+class HashSet {
+    impl::HashTable<K, Hasher> table;
+public:
+    size_t size() const { return table.size(); }
+    size_t cap() const { return table.cap(); }
+    bool is_empty() const { return table.size() == 0; }
+
+    void reserve(size_t min_size) { table.reserve(min_size); }
+    void clear() { table.clear(); }
+
+    /// Returns true if the key was newly inserted.
+    bool insert(K key) {
+        bool inserted;
+        K* slot = table.find_or_prepare_insert(key, &inserted);
+        if(inserted) {
+            new(slot) K(std::move(key));
+        }
+        return inserted;
+    }
+
+    template<typename Q>
+    bool contains(const Q& key) const {
+        return table.find(key) != nullptr;
+    }
+
+    template<typename Q>
+    bool remove(const Q& key) {
+        if(K* slot = table.find(key)) {
+            table.erase(slot);
+            return true;
+        }
+        return false;
+    }
+
+    auto iter() const { return table.iter(); }
+};
+
+};
@@ -0,0 +1,421 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <concepts>
+#include <type_traits>
+#include <utility>
+
+#include "option.h"
+
+namespace zw {
+
+// An iterable is any class with an Iterator type and const begin()/end() methods. Its iterator has an Element
+// type, prefix ++, == and !=, and operator*. Deriving from Iterable<Self> adds the lazy adaptors below,
+// each of which takes ownership of the iterable it's called on and is itself an Iterable.
+//
+// An iterable may also have a size_hint() method returning a lower bound on the number of elements it yields;
+// collect() reserves that many up front.
+
+namespace impl {
+    template<typename I>
+    size_t size_hint(const I& iterable) {
+        if constexpr(requires { iterable.size_hint(); }) {
+            return iterable.size_hint();
+        } else {
+            return 0;
+        }
+    }
+
+    inline size_t min(size_t a, size_t b) { return a < b ? a : b; }
+};
+
+template<typename Iter> class EnumerateIterable;
+template<typename Iter, typename F> class MapIterable;
+template<typename Iter, typename F> class FilterIterable;
+template<typename Iter, typename F> class FlatMapIterable;
+template<typename Left, typename Right> class ZipIterable;
+template<typename Iter> class TakeIterable;
+template<typename Iter> class SkipIterable;
+template<typename Slice> class ChunksIterable;
+template<typename Slice> class WindowsIterable;
+
+template<typename Slice>
+concept SliceIterable = requires(const Slice& slice) {
+    { slice.size() } -> std::same_as<size_t>;
+    { slice.subrange(0, 0) } -> std::same_as<Slice>;
+};
+
+template<typename Iter>
+class Iterable {
+    Iter&& take_self() { return std::move(*static_cast<Iter*>(this)); }
+public:
+    auto enumerate() {
+        return EnumerateIterable<Iter>(take_self());
+    }
+
+    /// Yields f(element) for each element.
+    template<typename F>
+    auto map(F f) { return MapIterable<Iter, F>(take_self(), std::move(f)); }
+
+    /// Yields only the elements for which f(element) is true.
+    template<typename F>
+    auto filter(F f) { return FilterIterable<Iter, F>(take_self(), std::move(f)); }
+
+    /// f(element) must return an iterable; yields each of its elements in turn.
+    template<typename F>
+    auto flat_map(F f) { return FlatMapIterable<Iter, F>(take_self(), std::move(f)); }
+
+    /// Yields pairs of elements from this and other, stopping at the end of the shorter one.
+    template<typename Other>
+    auto zip(Other other) { return ZipIterable<Iter, Other>(take_self(), std::move(other)); }
+
+    auto take(size_t count) { return TakeIterable<Iter>(take_self(), count); }
+    auto skip(size_t count) { return SkipIterable<Iter>(take_self(), count); }
+
+    /// Yields consecutive non-overlapping sub-views of count elements; the last one may be shorter.
+    auto chunks(size_t count) requires SliceIterable<Iter> { return ChunksIterable<Iter>(take_self(), count); }
+    /// Yields every overlapping sub-view of count consecutive elements.
+    auto windows(size_t count) requires SliceIterable<Iter> { return WindowsIterable<Iter>(take_self(), count); }
+
+    /// Pushes every element into a new Collection (e.g. an Array), reserving room for size_hint() elements first.
+    template<typename Collection>
+    Collection collect() {
+        Iter& self = *static_cast<Iter*>(this);
+        Collection result;
+        result.reserve(impl::size_hint(self));
+        for(auto&& element: self) {
+            result.push(std::forward<decltype(element)>(element));
+        }
+        return result;
+    }
+};
+
+template<typename Iter>
+class EnumerateIterator {
+    size_t number;
+    Iter iter;
+public:
+    using Element = std::pair<size_t, typename Iter::Element>;
+
+    EnumerateIterator(Iter&& iter) : number(0), iter(std::move(iter)) {}
+
+    EnumerateIterator<Iter>& operator++() {
+        ++iter;
+        ++number;
+        return *this;
+    }
+
+    bool operator==(const EnumerateIterator<Iter>& other) const { return iter == other.iter; }
+    bool operator!=(const EnumerateIterator<Iter>& other) const { return iter != other.iter; }
+    Element operator*() {
+        return Element(number, *iter);
+    }
+};
+
+template<typename Iter>
+class EnumerateIterable: public Iterable<EnumerateIterable<Iter>> {
+    Iter iterable;
+public:
+    EnumerateIterable(Iter&& iterable) : iterable(std::move(iterable)) {}
+    using Iterator = EnumerateIterator<typename Iter::Iterator>;
+
+    Iterator begin() const { return Iterator(iterable.begin()); }
+    Iterator end() const { return Iterator(iterable.end()); }
+    size_t size_hint() const { return impl::size_hint(iterable); }
+};
+
+// The adaptor iterators below carry their own copy of the function object rather than pointing back at the
+// iterable, so they stay valid when moved around (flat_map relies on this).
+
+template<typename Iter, typename F>
+class MapIterator {
+    Iter iter;
+    F f;
+public:
+    using Element = std::invoke_result_t<F&, typename Iter::Element>;
+
+    MapIterator(Iter&& iter, const F& f) : iter(std::move(iter)), f(f) {}
+
+    MapIterator<Iter, F>& operator++() {
+        ++iter;
+        return *this;
+    }
+
+    bool operator==(const MapIterator<Iter, F>& other) const { return iter == other.iter; }
+    bool operator!=(const MapIterator<Iter, F>& other) const { return iter != other.iter; }
+    Element operator*() { return f(*iter); }
+};
+
+template<typename Iter, typename F>
+class MapIterable: public Iterable<MapIterable<Iter, F>> {
+    Iter iterable;
+    F f;
+public:
+    using Iterator = MapIterator<typename Iter::Iterator, F>;
+
+    MapIterable(Iter&& iterable, F&& f) : iterable(std::move(iterable)), f(std::move(f)) {}
+    Iterator begin() const { return Iterator(iterable.begin(), f); }
+    Iterator end() const { return Iterator(iterable.end(), f); }
+    size_t size_hint() const { return impl::size_hint(iterable); }
+};
+
+template<typename Iter, typename F>
+class FilterIterator {
+    Iter iter;
+    Iter end;
+    F f;
+
+    void skip_rejected() {
+        while(iter != end) {
+            // Named, so that f sees an lvalue even when the elements are being moved out
+            auto&& element = *iter;
+            if(f(element)) break;
+            ++iter;
+        }
+    }
+public:
+    using Element = typename Iter::Element;
+
+    FilterIterator(Iter&& iter, Iter&& end, const F& f) : iter(std::move(iter)), end(std::move(end)), f(f) {
+        skip_rejected();
+    }
+
+    FilterIterator<Iter, F>& operator++() {
+        ++iter;
+        skip_rejected();
+        return *this;
+    }
+
+    bool operator==(const FilterIterator<Iter, F>& other) const { return iter == other.iter; }
+    bool operator!=(const FilterIterator<Iter, F>& other) const { return iter != other.iter; }
+    Element operator*() { return *iter; }
+};
+
+template<typename Iter, typename F>
+class FilterIterable: public Iterable<FilterIterable<Iter, F>> {
+    Iter iterable;
+    F f;
+public:
+    using Iterator = FilterIterator<typename Iter::Iterator, F>;
+
+    FilterIterable(Iter&& iterable, F&& f) : iterable(std::move(iterable)), f(std::move(f)) {}
+    Iterator begin() const { return Iterator(iterable.begin(), iterable.end(), f); }
+    Iterator end() const { return Iterator(iterable.end(), iterable.end(), f); }
+};
+
+template<typename OuterIter, typename F>
+class FlatMapIterator {
+    using Inner = std::invoke_result_t<F&, typename OuterIter::Element>;
+    using InnerIter = typename Inner::Iterator;
+
+    OuterIter outer;
+    OuterIter outer_end;
+    F f;
+    // The current inner iterable is kept alive alongside its iterators, in case it owns its elements.
+    Option<Inner> inner;
+    Option<InnerIter> cur;
+    Option<InnerIter> cur_end;
+
+    bool is_done() const { return outer == outer_end && (!cur.is_present() || cur.unwrap() == cur_end.unwrap()); }
+
+    void advance_to_element() {
+        while(outer != outer_end && (!cur.is_present() || cur.unwrap() == cur_end.unwrap())) {
+            inner = f(*outer);
+            cur = inner.unwrap().begin();
+            cur_end = inner.unwrap().end();
+            ++outer;
+        }
+    }
+public:
+    using Element = typename InnerIter::Element;
+
+    FlatMapIterator(OuterIter&& outer, OuterIter&& outer_end, const F& f) : outer(std::move(outer)), outer_end(std::move(outer_end)), f(f) {
+        advance_to_element();
+    }
+
+    FlatMapIterator<OuterIter, F>& operator++() {
+        ++cur.unwrap();
+        advance_to_element();
+        return *this;
+    }
+
+    // Only meaningful for comparing against end()
+    bool operator==(const FlatMapIterator<OuterIter, F>& other) const { return is_done() == other.is_done(); }
+    bool operator!=(const FlatMapIterator<OuterIter, F>& other) const { return is_done() != other.is_done(); }
+    Element operator*() { return *cur.unwrap(); }
+};
+
+template<typename Iter, typename F>
+class FlatMapIterable: public Iterable<FlatMapIterable<Iter, F>> {
+    Iter iterable;
+    F f;
+public:
+    using Iterator = FlatMapIterator<typename Iter::Iterator, F>;
+
+    FlatMapIterable(Iter&& iterable, F&& f) : iterable(std::move(iterable)), f(std::move(f)) {}
+    Iterator begin() const { return Iterator(iterable.begin(), iterable.end(), f); }
+    Iterator end() const { return Iterator(iterable.end(), iterable.end(), f); }
+};
+
+template<typename Left, typename Right>
+class ZipIterator {
+    Left left;
+    Right right;
+public:
+    using Element = std::pair<typename Left::Element, typename Right::Element>;
+
+    ZipIterator(Left&& left, Right&& right) : left(std::move(left)), right(std::move(right)) {}
+
+    ZipIterator<Left, Right>& operator++() {
+        ++left;
+        ++right;
+        return *this;
+    }
+
+    // Either side reaching its end ends the zip
+    bool operator==(const ZipIterator<Left, Right>& other) const { return left == other.left || right == other.right; }
+    bool operator!=(const ZipIterator<Left, Right>& other) const { return !(*this == other); }
+    Element operator*() { return Element(*left, *right); }
+};
+
+template<typename Left, typename Right>
+class ZipIterable: public Iterable<ZipIterable<Left, Right>> {
+    Left left;
+    Right right;
+public:
+    using Iterator = ZipIterator<typename Left::Iterator, typename Right::Iterator>;
+
+    ZipIterable(Left&& left, Right&& right) : left(std::move(left)), right(std::move(right)) {}
+    Iterator begin() const { return Iterator(left.begin(), right.begin()); }
+    Iterator end() const { return Iterator(left.end(), right.end()); }
+    size_t size_hint() const { return impl::min(impl::size_hint(left), impl::size_hint(right)); }
+};
+
+template<typename Iter>
+class TakeIterator {
+    Iter iter;
+    size_t remaining;
+public:
+    using Element = typename Iter::Element;
+
+    TakeIterator(Iter&& iter, size_t remaining) : iter(std::move(iter)), remaining(remaining) {}
+
+    TakeIterator<Iter>& operator++() {
+        ++iter;
+        --remaining;
+        return *this;
+    }
+
+    bool operator==(const TakeIterator<Iter>& other) const { return remaining == other.remaining || iter == other.iter; }
+    bool operator!=(const TakeIterator<Iter>& other) const { return !(*this == other); }
+    Element operator*() { return *iter; }
+};
+
+template<typename Iter>
+class TakeIterable: public Iterable<TakeIterable<Iter>> {
+    Iter iterable;
+    size_t count;
+public:
+    using Iterator = TakeIterator<typename Iter::Iterator>;
+
+    TakeIterable(Iter&& iterable, size_t count) : iterable(std::move(iterable)), count(count) {}
+    Iterator begin() const { return Iterator(iterable.begin(), count); }
+    Iterator end() const { return Iterator(iterable.end(), 0); }
+    size_t size_hint() const { return impl::min(impl::size_hint(iterable), count); }
+};
+
+template<typename Iter>
+class SkipIterable: public Iterable<SkipIterable<Iter>> {
+    Iter iterable;
+    size_t count;
+public:
+    using Iterator = typename Iter::Iterator;
+
+    SkipIterable(Iter&& iterable, size_t count) : iterable(std::move(iterable)), count(count) {}
+    Iterator begin() const {
+        Iterator iter = iterable.begin();
+        Iterator end = iterable.end();
+        for(size_t i = 0; i < count && iter != end; i++) {
+            ++iter;
+        }
+        return iter;
+    }
+    Iterator end() const { return iterable.end(); }
+    size_t size_hint() const {
+        size_t hint = impl::size_hint(iterable);
+        return hint > count ? hint - count : 0;
+    }
+};
+
+template<typename Slice>
+class ChunksIterator {
+    Slice slice;
+    size_t pos;
+    size_t count;
+public:
+    using Element = Slice;
+
+    ChunksIterator(const Slice& slice, size_t pos, size_t count) : slice(slice), pos(pos), count(count) {}
+
+    ChunksIterator<Slice>& operator++() {
+        pos = impl::min(pos + count, slice.size());
+        return *this;
+    }
+
+    bool operator==(const ChunksIterator<Slice>& other) const { return pos == other.pos; }
+    bool operator!=(const ChunksIterator<Slice>& other) const { return pos != other.pos; }
+    Element operator*() { return slice.subrange(pos, impl::min(pos + count, slice.size())); }
+};
+
+template<typename Slice>
+class ChunksIterable: public Iterable<ChunksIterable<Slice>> {
+    Slice slice;
+    size_t count;
+public:
+    using Iterator = ChunksIterator<Slice>;
+
+    ChunksIterable(Slice&& slice, size_t count) : slice(std::move(slice)), count(count) {
+        assert(count > 0);
+    }
+    Iterator begin() const { return Iterator(slice, 0, count); }
+    Iterator end() const { return Iterator(slice, slice.size(), count); }
+    size_t size_hint() const { return (slice.size() + count - 1) / count; }
+};
+
+template<typename Slice>
+class WindowsIterator {
+    Slice slice;
+    size_t pos;
+    size_t count;
+public:
+    using Element = Slice;
+
+    WindowsIterator(const Slice& slice, size_t pos, size_t count) : slice(slice), pos(pos), count(count) {}
+
+    WindowsIterator<Slice>& operator++() {
+        ++pos;
+        return *this;
+    }
+
+    bool operator==(const WindowsIterator<Slice>& other) const { return pos == other.pos; }
+    bool operator!=(const WindowsIterator<Slice>& other) const { return pos != other.pos; }
+    Element operator*() { return slice.subrange(pos, pos + count); }
+};
+
+template<typename Slice>
+class WindowsIterable: public Iterable<WindowsIterable<Slice>> {
+    Slice slice;
+    size_t count;
+public:
+    using Iterator = WindowsIterator<Slice>;
+
+    WindowsIterable(Slice&& slice, size_t count) : slice(std::move(slice)), count(count) {
+        assert(count > 0);
+    }
+    Iterator begin() const { return Iterator(slice, 0, count); }
+    Iterator end() const { return Iterator(slice, size_hint(), count); }
+    size_t size_hint() const { return slice.size() >= count ? slice.size() - count + 1 : 0; }
+};
+
+};
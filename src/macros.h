@@ -4,4 +4,12 @@
 #define ZW_CONCAT(a,b) ZW_CONCAT_IMPL(a,b)
 
 #define ZW_STRINGIFY_IMPL(x) #x
-#define ZW_STRINGIFY(x) ZW_STRINGIFY_IMPL(x)
\ No newline at end of file
+#define ZW_STRINGIFY(x) ZW_STRINGIFY_IMPL(x)
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ZW_SSE2
+#endif
+
+#if defined(__AVX2__)
+#define ZW_AVX2
+#endif
@@ -1,7 +1,38 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
 #include <concepts>
 
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace zw {
+    constexpr size_t CACHE_LINE_SIZE = 64;
+
+    namespace impl {
+        // Full 128-bit product of a and b. Returns the low half and stores the high half in *high.
+        inline uint64_t multiply_128(uint64_t a, uint64_t b, uint64_t* high) {
+#if defined(_MSC_VER) && defined(_M_X64)
+            return _umul128(a, b, high);
+#elif defined(__SIZEOF_INT128__)
+            __uint128_t product = (__uint128_t)a * b;
+            *high = (uint64_t)(product >> 64);
+            return (uint64_t)product;
+#else
+            uint64_t a_high = a >> 32, a_low = (uint32_t)a;
+            uint64_t b_high = b >> 32, b_low = (uint32_t)b;
+            uint64_t high_high = a_high * b_high, high_low = a_high * b_low;
+            uint64_t low_high = a_low * b_high, low_low = a_low * b_low;
+            uint64_t middle = (low_low >> 32) + (uint32_t)high_low + low_high;
+            *high = high_high + (high_low >> 32) + (middle >> 32);
+            return (middle << 32) | (uint32_t)low_low;
+#endif
+        }
+    };
+};
+
 std::integral auto nearest_multiple_of(std::integral auto x, std::integral auto fac) {
     std::integral auto remainder = x % fac;
     if(remainder == 0) {
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <bit>
+#include <concepts>
+#include <type_traits>
+
+// Number to text conversion without sprintf. Each function writes into out, which must have room for the
+// matching MAX_*_CHARS, and returns the number of characters written; nothing is null-terminated.
+//
+// Decimal integers are written two digits at a time from a table of the 100 two-digit pairs. Floats are
+// written with the fewest digits that parse back to the same value (see number_format.cpp), in the style of
+// Python's repr(): "0.1", "3.0", "1e+16", "1.5e-07", "inf", "nan".
+
+namespace zw {
+
+constexpr size_t MAX_INTEGER_CHARS = 20;
+constexpr size_t MAX_HEX_CHARS = 16;
+constexpr size_t MAX_BINARY_CHARS = 64;
+constexpr size_t MAX_FLOAT_CHARS = 32;
+
+namespace impl {
+    inline constexpr char DIGIT_PAIRS[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    inline size_t count_digits(uint64_t value) {
+        size_t count = 1;
+        for(;;) {
+            if(value < 10) return count;
+            if(value < 100) return count + 1;
+            if(value < 1000) return count + 2;
+            if(value < 10000) return count + 3;
+            value /= 10000;
+            count += 4;
+        }
+    }
+
+    // Writes exactly num_digits digits of value, which must have that many, ending at out + num_digits.
+    inline void write_digits(uint64_t value, char* out, size_t num_digits) {
+        char* p = out + num_digits;
+        while(value >= 100) {
+            size_t pair = (size_t)(value % 100) * 2;
+            value /= 100;
+            p -= 2;
+            memcpy(p, DIGIT_PAIRS + pair, 2);
+        }
+        if(value >= 10) {
+            p -= 2;
+            memcpy(p, DIGIT_PAIRS + value * 2, 2);
+        } else {
+            *--p = (char)('0' + value);
+        }
+    }
+
+    inline size_t format_unsigned(uint64_t value, char* out) {
+        size_t num_digits = count_digits(value);
+        write_digits(value, out, num_digits);
+        return num_digits;
+    }
+};
+
+template<std::integral T>
+size_t format_integer(T value, char* out) {
+    if constexpr(std::is_signed_v<T>) {
+        if(value < 0) {
+            *out = '-';
+            // Negating in unsigned arithmetic is fine for the minimum value too
+            return 1 + impl::format_unsigned(0 - (uint64_t)(int64_t)value, out + 1);
+        }
+    }
+    return impl::format_unsigned((uint64_t)value, out);
+}
+
+/// Lower-case hexadecimal, without a prefix or leading zeros.
+inline size_t format_hex(uint64_t value, char* out) {
+    size_t num_digits = value ? (67 - std::countl_zero(value)) / 4 : 1;
+    for(size_t i = num_digits; i > 0; i--) {
+        out[i - 1] = "0123456789abcdef"[value & 0xF];
+        value >>= 4;
+    }
+    return num_digits;
+}
+
+/// Binary, without a prefix or leading zeros.
+inline size_t format_binary(uint64_t value, char* out) {
+    size_t num_digits = value ? 64 - std::countl_zero(value) : 1;
+    for(size_t i = num_digits; i > 0; i--) {
+        out[i - 1] = (char)('0' + (value & 1));
+        value >>= 1;
+    }
+    return num_digits;
+}
+
+size_t format_float(double value, char* out);
+size_t format_float(float value, char* out);
+
+};
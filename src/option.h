@@ -1,51 +1,134 @@
 #pragma once
 
 #include <assert.h>
+#include <string.h>
+#include <new>
+#include <utility>
 
 namespace zw {
 
-template<typename Wrapped>
-class Option {
-    union {
-        Wrapped _object;
+/// Specialize OptionNiche<T> for a type with a bit pattern that no valid value ever has, such as a null
+/// pointer or an out of range handle, to let Option<T> use that pattern to mean "not present" instead of
+/// storing a separate flag. Option<T> is then no bigger than T. A specialization needs:
+///
+///     static constexpr bool HAS_NICHE = true;
+///     // Puts the pattern into storage, which doesn't hold an object
+///     static void set_none(T* storage);
+///     // Whether storage holds the pattern rather than an object
+///     static bool is_none(const T* storage);
+///
+/// Putting a value with the pattern into an Option is a bug, which is caught by an assertion.
+template<typename T>
+struct OptionNiche {
+    static constexpr bool HAS_NICHE = false;
+};
+
+/// Null pointers are not present, so Option<T*> can't hold one.
+template<typename T>
+struct OptionNiche<T*> {
+    static constexpr bool HAS_NICHE = true;
+    static void set_none(T** storage) { *storage = nullptr; }
+    static bool is_none(T* const* storage) { return *storage == nullptr; }
+};
+
+/// Niche for trivially copyable types that have one value that's never valid, e.g.
+/// template<> struct OptionNiche<Handle>: SentinelNiche<Handle, Handle { UINT32_MAX }> {};
+template<typename T, T SENTINEL>
+struct SentinelNiche {
+    static constexpr bool HAS_NICHE = true;
+    static void set_none(T* storage) {
+        T sentinel = SENTINEL;
+        memcpy((void*)storage, &sentinel, sizeof(T));
+    }
+    static bool is_none(const T* storage) {
+        T sentinel = SENTINEL;
+        return memcmp((const void*)storage, &sentinel, sizeof(T)) == 0;
+    }
+};
+
+namespace impl {
+    template<typename Wrapped, bool HAS_NICHE = OptionNiche<Wrapped>::HAS_NICHE>
+    class OptionStorage {
+    protected:
+        union {
+            Wrapped _object;
+        };
+        bool _is_present;
+
+        OptionStorage() {}
+        ~OptionStorage() {}
+
+        bool has_object() const { return _is_present; }
+        void mark_present() { _is_present = true; }
+        void mark_absent() { _is_present = false; }
     };
-    bool _is_present;
+
+    template<typename Wrapped>
+    class OptionStorage<Wrapped, true> {
+    protected:
+        union {
+            Wrapped _object;
+        };
+
+        OptionStorage() {}
+        ~OptionStorage() {}
+
+        bool has_object() const { return !OptionNiche<Wrapped>::is_none(&_object); }
+        void mark_present() {
+            assert(has_object() && "value is its type's OptionNiche pattern");
+        }
+        void mark_absent() { OptionNiche<Wrapped>::set_none(&_object); }
+    };
+};
+
+template<typename Wrapped>
+class Option: impl::OptionStorage<Wrapped> {
+    using impl::OptionStorage<Wrapped>::_object;
+    using impl::OptionStorage<Wrapped>::has_object;
+    using impl::OptionStorage<Wrapped>::mark_present;
+    using impl::OptionStorage<Wrapped>::mark_absent;
 public:
     Option() {
-        _is_present = false;
+        mark_absent();
     }
 
     Option(Wrapped&& object) {
         new(&_object) Wrapped(std::move(object));
-        _is_present = true;
+        mark_present();
     }
 
     Option(Option<Wrapped>&& other) {
-        _is_present = other._is_present;
-        if(other._is_present) {
+        if(other.has_object()) {
             new(&_object) Wrapped(std::move(other._object));
+            mark_present();
             other._object.~Wrapped();
-            other._is_present = false;
+            other.mark_absent();
+        } else {
+            mark_absent();
         }
     }
 
     Option(const Option<Wrapped>& other) {
-        _is_present = other._is_present;
-        if(other._is_present) {
+        if(other.has_object()) {
             new(&_object) Wrapped(other._object);
+            mark_present();
+        } else {
+            mark_absent();
         }
     }
 
     Option& operator=(Option<Wrapped>&& other) {
         if(this != &other) {
-            if(_is_present) {
+            if(has_object()) {
                 _object.~Wrapped();
             }
-            _is_present = other._is_present;
-            if(other._is_present) {
+            if(other.has_object()) {
                 new(&_object) Wrapped(std::move(other._object));
-                other._is_present = false;
+                mark_present();
                 other._object.~Wrapped();
+                other.mark_absent();
+            } else {
+                mark_absent();
             }
         }
         return *this;
@@ -53,42 +136,48 @@ public:
 
     Option& operator=(const Option<Wrapped>& other) {
         if(this != &other) {
-            if(_is_present) {
+            if(has_object()) {
                 _object.~Wrapped();
             }
-            _is_present = other._is_present;
-            new(&_object) Wrapped(other._object);
+            if(other.has_object()) {
+                new(&_object) Wrapped(other._object);
+                mark_present();
+            } else {
+                mark_absent();
+            }
         }
         return *this;
     }
 
     ~Option() {
-        if(_is_present) {
+        if(has_object()) {
             _object.~Wrapped();
-            _is_present = false;
         }
     }
 
-    bool is_present() const { return _is_present; }
+    bool is_present() const { return has_object(); }
     Wrapped const& unwrap() const {
-        assert(_is_present);
+        assert(has_object());
         return _object;
     }
     Wrapped& unwrap() {
-        assert(_is_present);
+        assert(has_object());
         return _object;
     }
 
     /// Just like unwrap(), except it moves the object out of the Option
     /// Does not run destructor on moved-from object
     Wrapped take() {
-        assert(_is_present);
-        _is_present = false;
-        return std::move(_object);
+        assert(has_object());
+        Wrapped object = std::move(_object);
+        mark_absent();
+        return object;
     }
 };
 
 template<typename Wrapped>
 Option<Wrapped> none() { return {}; }
 
-};
\ No newline at end of file
+static_assert(sizeof(Option<int*>) == sizeof(int*));
+
+};
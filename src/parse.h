@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <concepts>
+#include <limits>
+
+#include "option.h"
+#include "string.h"
+
+// Number parsing straight from string slices, without needing a null terminator. The whole slice must be the
+// number: there is no skipping of whitespace and no trailing garbage, and anything else gives an empty Option.
+//
+// Integers are an optional sign followed by decimal digits, eight of which are converted at a time with SWAR
+// arithmetic on a 64-bit word. Floats additionally take a fraction, an exponent, "inf", "infinity" and "nan",
+// and are correctly rounded: see parse.cpp.
+
+namespace zw {
+
+namespace impl {
+    inline uint64_t read_eight_bytes(const char* p) {
+        uint64_t value;
+        memcpy(&value, p, 8);
+        return value;
+    }
+
+    inline bool is_eight_digits(uint64_t bytes) {
+        // Each byte is a digit exactly if adding 0x46 doesn't carry into its top bit and subtracting 0x30 doesn't borrow
+        return !(((bytes + 0x4646464646464646ull) | (bytes - 0x3030303030303030ull)) & 0x8080808080808080ull);
+    }
+
+    // Value of eight ASCII digits loaded little-endian, so that the first digit is in the lowest byte
+    inline uint32_t parse_eight_digits(uint64_t bytes) {
+        bytes -= 0x3030303030303030ull;
+        // Combine adjacent digits into 2-digit values in every other byte, then those into 4 digits, then 8
+        bytes = (bytes * 10) + (bytes >> 8);
+        const uint64_t mask = 0x000000FF000000FFull;
+        const uint64_t mul1 = 0x000F424000000064ull; // 100 + (1000000 << 32)
+        const uint64_t mul2 = 0x0000271000000001ull; // 1 + (10000 << 32)
+        return (uint32_t)((((bytes & mask) * mul1) + (((bytes >> 16) & mask) * mul2)) >> 32);
+    }
+
+    inline bool is_digit(char c) { return (uint8_t)(c - '0') < 10; }
+
+    // Parses all of [p, end) as digits, which must not overflow a uint64_t.
+    inline Option<uint64_t> parse_digits(const char* p, const char* end) {
+        if(p == end) return {};
+        // Leading zeros don't count towards the 20 digits a uint64_t can hold
+        while(p != end && *p == '0') {
+            p++;
+        }
+        size_t num_digits = end - p;
+        if(num_digits > 20) return {};
+
+        uint64_t value = 0;
+        // Up to 19 digits can't overflow
+        const char* fast_end = num_digits == 20 ? end - 1 : end;
+        while(fast_end - p >= 8) {
+            uint64_t bytes = read_eight_bytes(p);
+            if(!is_eight_digits(bytes)) return {};
+            value = value * 100000000 + parse_eight_digits(bytes);
+            p += 8;
+        }
+        for(; p != fast_end; p++) {
+            if(!is_digit(*p)) return {};
+            value = value * 10 + (*p - '0');
+        }
+        if(p != end) {
+            if(!is_digit(*p)) return {};
+            uint64_t digit = *p - '0';
+            constexpr uint64_t MAX_DIV_10 = UINT64_MAX / 10;
+            if(value > MAX_DIV_10 || (value == MAX_DIV_10 && digit > UINT64_MAX % 10)) return {};
+            value = value * 10 + digit;
+        }
+        return value;
+    }
+
+    Option<double> parse_double(StringSlice string);
+    Option<float> parse_float(StringSlice string);
+};
+
+template<typename T>
+requires std::integral<T> || std::floating_point<T>
+Option<T> parse(StringSlice string) {
+    if constexpr(std::same_as<T, double>) {
+        return impl::parse_double(string);
+    } else if constexpr(std::same_as<T, float>) {
+        return impl::parse_float(string);
+    } else if constexpr(std::same_as<T, bool> || !std::integral<T>) {
+        static_assert(sizeof(T) == 0, "parse() supports integers, float and double");
+    } else {
+        const char* p = string.data();
+        const char* end = p + string.size();
+        bool is_negative = false;
+        if(p != end && (*p == '-' || *p == '+')) {
+            is_negative = *p == '-';
+            if(is_negative && std::is_unsigned_v<T>) return {};
+            p++;
+        }
+        Option<uint64_t> magnitude = impl::parse_digits(p, end);
+        if(!magnitude.is_present()) return {};
+        uint64_t value = magnitude.unwrap();
+
+        using Unsigned = std::make_unsigned_t<T>;
+        constexpr uint64_t MAX = (uint64_t)std::numeric_limits<T>::max();
+        if(is_negative) {
+            // The magnitude of the minimum is one more than the maximum
+            if(value > MAX + 1) return {};
+            return (T)(Unsigned)(0 - value);
+        }
+        if(value > MAX) return {};
+        return (T)value;
+    }
+}
+
+};
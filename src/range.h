@@ -1,10 +1,14 @@
 #pragma once
 
+#include "iter.h"
+
 namespace zw {
 
 struct RangeIterator {
     size_t value;
 
+    using Element = size_t;
+
     RangeIterator& operator++() {
         ++value;
         return *this;
@@ -17,7 +21,7 @@ struct RangeIterator {
     }
 };
 
-struct Range {
+struct Range: public Iterable<Range> {
     size_t lower_bound = 0;
     size_t upper_bound = 0;
 
@@ -26,6 +30,14 @@ struct Range {
 
     RangeIterator begin() const { return {lower_bound}; }
     RangeIterator end() const { return {upper_bound}; }
+
+    using Iterator = RangeIterator;
+    size_t size() const { return upper_bound - lower_bound; }
+    size_t size_hint() const { return size(); }
+    Range subrange(size_t begin, size_t end) const {
+        assert(begin <= end && lower_bound + end <= upper_bound);
+        return Range(lower_bound + begin, lower_bound + end);
+    }
 };
 
 };
\ No newline at end of file
@@ -0,0 +1,341 @@
+#pragma once
+
+#include <assert.h>
+#include <bit>
+#include <type_traits>
+#include <utility>
+
+#include "alloc.h"
+#include "array.h"
+#include "option.h"
+#include "range.h"
+
+namespace zw {
+
+template<typename T, typename Ref>
+class RingBufferIterator {
+    T* data;
+    size_t mask;
+    size_t index;
+
+public:
+    using Element = Ref;
+
+    RingBufferIterator(T* data, size_t mask, size_t index) : data(data), mask(mask), index(index) {}
+
+    RingBufferIterator<T, Ref>& operator++() {
+        ++index;
+        return *this;
+    }
+
+    bool operator==(const RingBufferIterator<T, Ref>& other) const { return index == other.index; }
+    bool operator!=(const RingBufferIterator<T, Ref>& other) const { return index != other.index; }
+    Ref operator*() { return data[index & mask]; }
+};
+
+template<typename T, typename Ref>
+class RingBufferIterable: public Iterable<RingBufferIterable<T, Ref>> {
+    T* data;
+    size_t mask;
+    size_t head;
+    size_t size;
+
+public:
+    using Iterator = RingBufferIterator<T, Ref>;
+
+    RingBufferIterable(T* data, size_t mask, size_t head, size_t size) : data(data), mask(mask), head(head), size(size) {}
+    Iterator begin() const { return Iterator(data, mask, head); }
+    Iterator end() const { return Iterator(data, mask, head + size); }
+    size_t size_hint() const { return size; }
+};
+
+/// Fixed-capacity FIFO/LIFO queue over a power-of-two circular buffer. Pushing to and popping from either
+/// end is O(1). The storage comes from the context allocator, or from inside the object for InlineRingBuffer.
+template<typename T>
+class RingBuffer: ZwObject {
+protected:
+    T* _data = nullptr;
+    size_t _cap = 0;
+    size_t _head = 0;
+    size_t _size = 0;
+    bool _owns_data = false;
+
+    RingBuffer(T* storage, size_t cap) : _data(storage), _cap(cap) {
+        assert((cap & (cap - 1)) == 0 && "RingBuffer capacity must be a power of two");
+    }
+
+    size_t physical_index(size_t index) const { return (_head + index) & (_cap - 1); }
+
+    // Relocates the contents into a new owned buffer of new_cap elements, unwrapping them so that _head becomes 0.
+    void relocate(size_t new_cap) {
+        assert(new_cap >= _size && (new_cap & (new_cap - 1)) == 0);
+        T* new_data = (T*)zw_alloc(sizeof(T) * new_cap, alignof(T));
+        assert(new_data && "allocator out of memory");
+        for(auto i: Range(_size)) {
+            T& element = _data[physical_index(i)];
+            new(&new_data[i]) T(std::move(element));
+            element.~T();
+        }
+        if(_owns_data) {
+            zw_free(_data);
+        }
+        _data = new_data;
+        _cap = new_cap;
+        _head = 0;
+        _owns_data = true;
+    }
+
+    template<typename Source>
+    void construct_at(size_t index, Source&& element) {
+        new(&_data[physical_index(index)]) T(std::forward<Source>(element));
+    }
+
+public:
+    RingBuffer() = default;
+    explicit RingBuffer(size_t min_cap) {
+        if(min_cap) {
+            relocate(std::bit_ceil(min_cap));
+        }
+    }
+    RingBuffer(const RingBuffer<T>& other) : ZwObject(other) {
+        if(other._cap) {
+            relocate(other._cap);
+        }
+        for(auto i: Range(other._size)) {
+            construct_at(i, other[i]);
+        }
+        _size = other._size;
+    }
+    RingBuffer(RingBuffer<T>&& other) noexcept {
+        if(other._owns_data) {
+            swap(*this, other);
+        } else {
+            // Inline storage can't be stolen, so the elements have to be moved one by one.
+            if(other._cap) {
+                relocate(other._cap);
+            }
+            for(auto i: Range(other._size)) {
+                construct_at(i, std::move(other[i]));
+            }
+            _size = other._size;
+            other.clear();
+        }
+    }
+
+    RingBuffer<T>& operator=(const RingBuffer<T>& other) {
+        if(this != &other) {
+            RingBuffer<T> temp = other;
+            swap(*this, temp);
+        }
+        return *this;
+    }
+
+    RingBuffer<T>& operator=(RingBuffer<T>&& other) {
+        if(this != &other) {
+            RingBuffer<T> temp = std::move(other);
+            swap(*this, temp);
+        }
+        return *this;
+    }
+
+    ~RingBuffer() {
+        clear();
+        if(_owns_data) {
+            zw_free(_data);
+        }
+    }
+
+    size_t size() const { return _size; }
+    size_t cap() const { return _cap; }
+    Range indices() const { return Range(_size); }
+    bool is_empty() const { return _size == 0; }
+    bool is_full() const { return _size == _cap; }
+
+    void clear() {
+        if constexpr(!std::is_trivially_destructible_v<T>) {
+            for(auto i: indices()) {
+                _data[physical_index(i)].~T();
+            }
+        }
+        _head = 0;
+        _size = 0;
+    }
+
+    void push_back(const T& element) {
+        assert(!is_full());
+        construct_at(_size, element);
+        _size++;
+    }
+
+    void push_back(T&& element) {
+        assert(!is_full());
+        construct_at(_size, std::move(element));
+        _size++;
+    }
+
+    void push_front(const T& element) {
+        assert(!is_full());
+        _head = (_head - 1) & (_cap - 1);
+        construct_at(0, element);
+        _size++;
+    }
+
+    void push_front(T&& element) {
+        assert(!is_full());
+        _head = (_head - 1) & (_cap - 1);
+        construct_at(0, std::move(element));
+        _size++;
+    }
+
+    Option<T> pop_front() {
+        if(is_empty()) return {};
+
+        T& element = _data[_head];
+        Option<T> result = std::move(element);
+        element.~T();
+        _head = (_head + 1) & (_cap - 1);
+        _size--;
+        return result;
+    }
+
+    Option<T> pop_back() {
+        if(is_empty()) return {};
+
+        T& element = _data[physical_index(_size - 1)];
+        Option<T> result = std::move(element);
+        element.~T();
+        _size--;
+        return result;
+    }
+
+    /// Copies as many of the count elements at items as fit onto the back, and returns how many were pushed.
+    size_t push_back_many(const T* items, size_t count) {
+        size_t num_pushed = count < _cap - _size ? count : _cap - _size;
+        if constexpr(std::is_trivially_copyable_v<T>) {
+            // At most two contiguous runs: up to the physical end of the buffer, then from its start.
+            size_t start = physical_index(_size);
+            size_t first_run = num_pushed < _cap - start ? num_pushed : _cap - start;
+            memcpy(_data + start, items, sizeof(T) * first_run);
+            memcpy(_data, items + first_run, sizeof(T) * (num_pushed - first_run));
+        } else {
+            for(auto i: Range(num_pushed)) {
+                construct_at(_size + i, items[i]);
+            }
+        }
+        _size += num_pushed;
+        return num_pushed;
+    }
+
+    /// Moves up to count elements off the front into out, which must point to count constructed elements.
+    /// Returns how many were popped.
+    size_t pop_front_many(T* out, size_t count) {
+        size_t num_popped = count < _size ? count : _size;
+        if constexpr(std::is_trivially_copyable_v<T>) {
+            size_t first_run = num_popped < _cap - _head ? num_popped : _cap - _head;
+            memcpy(out, _data + _head, sizeof(T) * first_run);
+            memcpy(out + first_run, _data, sizeof(T) * (num_popped - first_run));
+        } else {
+            for(auto i: Range(num_popped)) {
+                T& element = _data[physical_index(i)];
+                out[i] = std::move(element);
+                element.~T();
+            }
+        }
+        _head = num_popped ? physical_index(num_popped) : _head;
+        _size -= num_popped;
+        return num_popped;
+    }
+
+    const T& operator[](size_t index) const {
+        assert(index < _size);
+        return _data[physical_index(index)];
+    }
+
+    T& operator[](size_t index) {
+        assert(index < _size);
+        return _data[physical_index(index)];
+    }
+
+    T& front() { return (*this)[0]; }
+    const T& front() const { return (*this)[0]; }
+    T& last() { return (*this)[_size - 1]; }
+    const T& last() const { return (*this)[_size - 1]; }
+
+    RingBufferIterable<const T, const T&> iter() const { return {_data, _cap - 1, _head, _size}; }
+    RingBufferIterable<T, T&> iter_mut() { return {_data, _cap - 1, _head, _size}; }
+
+    friend void swap(RingBuffer<T>& left, RingBuffer<T>& right) {
+        std::swap(left._data, right._data);
+        std::swap(left._cap, right._cap);
+        std::swap(left._head, right._head);
+        std::swap(left._size, right._size);
+        std::swap(left._owns_data, right._owns_data);
+    }
+};
+
+template<typename T, size_t Cap>
+class InlineRingBuffer: public RingBuffer<T> {
+    static_assert(Cap > 0 && (Cap & (Cap - 1)) == 0, "InlineRingBuffer capacity must be a power of two");
+    alignas(T) uint8_t storage[sizeof(T) * Cap];
+public:
+    InlineRingBuffer() : RingBuffer<T>((T*)storage, Cap) {}
+
+    InlineRingBuffer(const InlineRingBuffer<T, Cap>& other) = delete;
+    InlineRingBuffer(InlineRingBuffer<T, Cap>&& other) = delete;
+    InlineRingBuffer& operator=(const InlineRingBuffer<T, Cap>& other) = delete;
+    InlineRingBuffer& operator=(InlineRingBuffer<T, Cap>&& other) = delete;
+};
+
+/// Growable double-ended queue. Same layout as RingBuffer, but doubles its capacity instead of filling up.
+template<typename T>
+class Deque: public RingBuffer<T> {
+    constexpr static size_t INITIAL_CAPACITY = 4;
+
+    void make_room(size_t extra) {
+        size_t min_cap = this->_size + extra;
+        if(min_cap > this->_cap) {
+            size_t new_cap = this->_cap ? this->_cap : INITIAL_CAPACITY;
+            while(new_cap < min_cap) {
+                new_cap *= 2;
+            }
+            this->relocate(new_cap);
+        }
+    }
+
+public:
+    Deque() = default;
+
+    void reserve(size_t min_cap) {
+        if(min_cap > this->_size) {
+            make_room(min_cap - this->_size);
+        }
+    }
+
+    void push_back(const T& element) {
+        make_room(1);
+        RingBuffer<T>::push_back(element);
+    }
+
+    void push_back(T&& element) {
+        make_room(1);
+        RingBuffer<T>::push_back(std::move(element));
+    }
+
+    void push_front(const T& element) {
+        make_room(1);
+        RingBuffer<T>::push_front(element);
+    }
+
+    void push_front(T&& element) {
+        make_room(1);
+        RingBuffer<T>::push_front(std::move(element));
+    }
+
+    /// Copies all count elements at items onto the back, growing at most once.
+    void push_back_many(const T* items, size_t count) {
+        make_room(count);
+        RingBuffer<T>::push_back_many(items, count);
+    }
+};
+
+};
@@ -0,0 +1,492 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <bit>
+#include <concepts>
+#include <type_traits>
+#include <utility>
+
+#include "alloc.h"
+#include "defer.h"
+
+namespace zw {
+
+struct Less {
+    template<typename A, typename B>
+    bool operator()(const A& a, const B& b) const { return a < b; }
+};
+
+template<typename K>
+concept RadixKey = (std::integral<K> && !std::same_as<K, bool>) || std::same_as<K, float> || std::same_as<K, double>;
+
+namespace impl {
+
+constexpr size_t INSERTION_SORT_THRESHOLD = 24;
+constexpr size_t NINTHER_THRESHOLD = 128;
+constexpr size_t PARTIAL_INSERTION_SORT_LIMIT = 8;
+constexpr size_t MERGE_SORT_RUN = 16;
+constexpr size_t RADIX_SORT_THRESHOLD = 256;
+
+// Scratch memory for the out-of-place sorts. Comes from the temp allocator when it has room, and from the
+// context allocator otherwise. Must be the last temp allocation still live when it's freed, so that the temp
+// allocator gets the space back.
+template<typename T>
+struct SortScratch {
+    T* data;
+    bool is_temp;
+
+    explicit SortScratch(size_t count) {
+        data = (T*)zw_temp_alloc(sizeof(T) * count, alignof(T));
+        is_temp = data != nullptr;
+        if(!is_temp) {
+            data = (T*)zw_alloc(sizeof(T) * count, alignof(T));
+            assert(data && "allocator out of memory");
+        }
+    }
+    SortScratch(const SortScratch<T>& other) = delete;
+
+    ~SortScratch() {
+        if(is_temp) {
+            zw_temp_free(data);
+        } else {
+            zw_free(data);
+        }
+    }
+};
+
+template<typename T, typename F>
+void insertion_sort(T* begin, T* end, F& less) {
+    if(begin == end) return;
+
+    for(T* cur = begin + 1; cur != end; ++cur) {
+        T* sift = cur;
+        T* sift_1 = cur - 1;
+        if(less(*sift, *sift_1)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*sift_1);
+            } while(sift != begin && less(tmp, *--sift_1));
+            *sift = std::move(tmp);
+        }
+    }
+}
+
+// Like insertion_sort, but assumes *(begin - 1) is not greater than any element of the range, which
+// serves as a sentinel.
+template<typename T, typename F>
+void unguarded_insertion_sort(T* begin, T* end, F& less) {
+    if(begin == end) return;
+
+    for(T* cur = begin + 1; cur != end; ++cur) {
+        T* sift = cur;
+        T* sift_1 = cur - 1;
+        if(less(*sift, *sift_1)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*sift_1);
+            } while(less(tmp, *--sift_1));
+            *sift = std::move(tmp);
+        }
+    }
+}
+
+// Insertion sort that gives up once it has moved more than PARTIAL_INSERTION_SORT_LIMIT elements.
+// Returns whether the range ended up sorted.
+template<typename T, typename F>
+bool partial_insertion_sort(T* begin, T* end, F& less) {
+    if(begin == end) return true;
+
+    size_t limit = 0;
+    for(T* cur = begin + 1; cur != end; ++cur) {
+        T* sift = cur;
+        T* sift_1 = cur - 1;
+        if(less(*sift, *sift_1)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*sift_1);
+            } while(sift != begin && less(tmp, *--sift_1));
+            *sift = std::move(tmp);
+            limit += cur - sift;
+            if(limit > PARTIAL_INSERTION_SORT_LIMIT) return false;
+        }
+    }
+    return true;
+}
+
+template<typename T, typename F>
+void sift_down(T* data, size_t size, size_t root, F& less) {
+    T tmp = std::move(data[root]);
+    for(;;) {
+        size_t child = root * 2 + 1;
+        if(child >= size) break;
+        if(child + 1 < size && less(data[child], data[child + 1])) child++;
+        if(!less(tmp, data[child])) break;
+        data[root] = std::move(data[child]);
+        root = child;
+    }
+    data[root] = std::move(tmp);
+}
+
+template<typename T, typename F>
+void heap_sort(T* begin, T* end, F& less) {
+    size_t size = end - begin;
+    for(size_t i = size / 2; i-- > 0;) {
+        sift_down(begin, size, i, less);
+    }
+    for(size_t i = size; i-- > 1;) {
+        std::swap(begin[0], begin[i]);
+        sift_down(begin, i, 0, less);
+    }
+}
+
+template<typename T, typename F>
+void sort2(T* a, T* b, F& less) {
+    if(less(*b, *a)) std::swap(*a, *b);
+}
+
+template<typename T, typename F>
+void sort3(T* a, T* b, T* c, F& less) {
+    sort2(a, b, less);
+    sort2(b, c, less);
+    sort2(a, b, less);
+}
+
+// Partitions [begin, end) around the pivot *begin. Elements equal to the pivot go to the right.
+// Returns the pivot's final position, and whether the range was already partitioned.
+template<typename T, typename F>
+std::pair<T*, bool> partition_right(T* begin, T* end, F& less) {
+    T pivot = std::move(*begin);
+    T* first = begin;
+    T* last = end;
+
+    // Guaranteed to stop: the median-of-3 pivot selection put an element >= pivot at the end.
+    while(less(*++first, pivot));
+
+    if(first - 1 == begin) {
+        while(first < last && !less(*--last, pivot));
+    } else {
+        while(!less(*--last, pivot));
+    }
+
+    bool already_partitioned = first >= last;
+    while(first < last) {
+        std::swap(*first, *last);
+        while(less(*++first, pivot));
+        while(!less(*--last, pivot));
+    }
+
+    T* pivot_pos = first - 1;
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return {pivot_pos, already_partitioned};
+}
+
+// Partitions [begin, end) around the pivot *begin, putting elements equal to the pivot on the left.
+// Used when the pivot equals the element preceding the range, in which case every element equal to
+// it is already in place, so runs of equal elements are dealt with in linear time.
+template<typename T, typename F>
+T* partition_left(T* begin, T* end, F& less) {
+    T pivot = std::move(*begin);
+    T* first = begin;
+    T* last = end;
+
+    while(less(pivot, *--last));
+
+    if(last + 1 == end) {
+        while(first < last && !less(pivot, *++first));
+    } else {
+        while(!less(pivot, *++first));
+    }
+
+    while(first < last) {
+        std::swap(*first, *last);
+        while(less(pivot, *--last));
+        while(!less(pivot, *++first));
+    }
+
+    T* pivot_pos = last;
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return pivot_pos;
+}
+
+// Pattern-defeating quicksort (Orson Peters). Quicksort with median-of-3/ninther pivots that falls back
+// to heap sort after too many unbalanced partitions, shuffles some elements around to break up adversarial
+// patterns, and finishes already-partitioned ranges with a bounded insertion sort.
+template<typename T, typename F>
+void pdqsort_loop(T* begin, T* end, F& less, int bad_allowed, bool leftmost) {
+    for(;;) {
+        size_t size = end - begin;
+        if(size < INSERTION_SORT_THRESHOLD) {
+            if(leftmost) {
+                insertion_sort(begin, end, less);
+            } else {
+                unguarded_insertion_sort(begin, end, less);
+            }
+            return;
+        }
+
+        size_t half = size / 2;
+        if(size > NINTHER_THRESHOLD) {
+            sort3(begin, begin + half, end - 1, less);
+            sort3(begin + 1, begin + (half - 1), end - 2, less);
+            sort3(begin + 2, begin + (half + 1), end - 3, less);
+            sort3(begin + (half - 1), begin + half, begin + (half + 1), less);
+            std::swap(*begin, *(begin + half));
+        } else {
+            sort3(begin + half, begin, end - 1, less);
+        }
+
+        if(!leftmost && !less(*(begin - 1), *begin)) {
+            begin = partition_left(begin, end, less) + 1;
+            continue;
+        }
+
+        auto [pivot_pos, already_partitioned] = partition_right(begin, end, less);
+
+        size_t left_size = pivot_pos - begin;
+        size_t right_size = end - (pivot_pos + 1);
+        bool highly_unbalanced = left_size < size / 8 || right_size < size / 8;
+        if(highly_unbalanced) {
+            if(--bad_allowed == 0) {
+                heap_sort(begin, end, less);
+                return;
+            }
+
+            if(left_size >= INSERTION_SORT_THRESHOLD) {
+                std::swap(*begin, *(begin + left_size / 4));
+                std::swap(*(pivot_pos - 1), *(pivot_pos - left_size / 4));
+                if(left_size > NINTHER_THRESHOLD) {
+                    std::swap(*(begin + 1), *(begin + (left_size / 4 + 1)));
+                    std::swap(*(begin + 2), *(begin + (left_size / 4 + 2)));
+                    std::swap(*(pivot_pos - 2), *(pivot_pos - (left_size / 4 + 1)));
+                    std::swap(*(pivot_pos - 3), *(pivot_pos - (left_size / 4 + 2)));
+                }
+            }
+            if(right_size >= INSERTION_SORT_THRESHOLD) {
+                std::swap(*(pivot_pos + 1), *(pivot_pos + (1 + right_size / 4)));
+                std::swap(*(end - 1), *(end - right_size / 4));
+                if(right_size > NINTHER_THRESHOLD) {
+                    std::swap(*(pivot_pos + 2), *(pivot_pos + (2 + right_size / 4)));
+                    std::swap(*(pivot_pos + 3), *(pivot_pos + (3 + right_size / 4)));
+                    std::swap(*(end - 2), *(end - (1 + right_size / 4)));
+                    std::swap(*(end - 3), *(end - (2 + right_size / 4)));
+                }
+            }
+        } else if(already_partitioned && partial_insertion_sort(begin, pivot_pos, less) && partial_insertion_sort(pivot_pos + 1, end, less)) {
+            return;
+        }
+
+        pdqsort_loop(begin, pivot_pos, less, bad_allowed, leftmost);
+        begin = pivot_pos + 1;
+        leftmost = false;
+    }
+}
+
+// Merges the sorted runs [first, mid) and [mid, last), buffering whichever is shorter in scratch.
+template<typename T, typename F>
+void merge_runs(T* first, T* mid, T* last, T* scratch, F& less) {
+    if(!less(*mid, *(mid - 1))) return;
+
+    if(mid - first <= last - mid) {
+        T* scratch_end = scratch;
+        for(T* it = first; it != mid; ++it) {
+            new(scratch_end++) T(std::move(*it));
+        }
+        T* a = scratch;
+        T* b = mid;
+        T* out = first;
+        while(a != scratch_end && b != last) {
+            if(less(*b, *a)) {
+                *out++ = std::move(*b++);
+            } else {
+                *out++ = std::move(*a++);
+            }
+        }
+        while(a != scratch_end) {
+            *out++ = std::move(*a++);
+        }
+        for(T* it = scratch; it != scratch_end; ++it) {
+            it->~T();
+        }
+    } else {
+        T* scratch_end = scratch;
+        for(T* it = mid; it != last; ++it) {
+            new(scratch_end++) T(std::move(*it));
+        }
+        T* a = mid;
+        T* b = scratch_end;
+        T* out = last;
+        while(a != first && b != scratch) {
+            if(less(*(b - 1), *(a - 1))) {
+                *--out = std::move(*--a);
+            } else {
+                *--out = std::move(*--b);
+            }
+        }
+        while(b != scratch) {
+            *--out = std::move(*--b);
+        }
+        for(T* it = scratch; it != scratch_end; ++it) {
+            it->~T();
+        }
+    }
+}
+
+template<RadixKey K>
+auto radix_bits(K key) {
+    using U = std::make_unsigned_t<std::conditional_t<std::is_floating_point_v<K>, std::conditional_t<sizeof(K) == 4, int32_t, int64_t>, K>>;
+    constexpr U SIGN = (U)1 << (sizeof(U) * 8 - 1);
+    if constexpr(std::is_floating_point_v<K>) {
+        // Negative floats sort in reverse order of their bits, so flip all of them; positive ones just need
+        // to end up above the negatives.
+        U bits = std::bit_cast<U>(key);
+        return (bits & SIGN) ? (U)~bits : (U)(bits | SIGN);
+    } else if constexpr(std::is_signed_v<K>) {
+        return (U)((U)key ^ SIGN);
+    } else {
+        return (U)key;
+    }
+}
+
+template<typename T, typename Q, typename F>
+size_t lower_bound(const T* data, size_t size, const Q& value, F& less) {
+    size_t low = 0;
+    while(size > 0) {
+        size_t half = size / 2;
+        if(less(data[low + half], value)) {
+            low += half + 1;
+            size -= half + 1;
+        } else {
+            size = half;
+        }
+    }
+    return low;
+}
+
+template<typename T, typename Q, typename F>
+size_t upper_bound(const T* data, size_t size, const Q& value, F& less) {
+    size_t low = 0;
+    while(size > 0) {
+        size_t half = size / 2;
+        if(!less(value, data[low + half])) {
+            low += half + 1;
+            size -= half + 1;
+        } else {
+            size = half;
+        }
+    }
+    return low;
+}
+
+};
+
+/// Sorts in place with pattern-defeating quicksort. Not stable. less(a, b) must be a strict weak ordering.
+template<typename T, typename F>
+void sort_by(T* data, size_t size, F less) {
+    if(size < 2) return;
+    impl::pdqsort_loop(data, data + size, less, std::bit_width(size), true);
+}
+
+template<typename T>
+void sort(T* data, size_t size) {
+    sort_by(data, size, Less());
+}
+
+/// Stable bottom-up merge sort. Needs scratch space for half the elements, which is taken from the temp
+/// allocator when it fits.
+template<typename T, typename F>
+void stable_sort_by(T* data, size_t size, F less) {
+    for(size_t begin = 0; begin < size; begin += impl::MERGE_SORT_RUN) {
+        size_t end = begin + impl::MERGE_SORT_RUN < size ? begin + impl::MERGE_SORT_RUN : size;
+        impl::insertion_sort(data + begin, data + end, less);
+    }
+    if(size <= impl::MERGE_SORT_RUN) return;
+
+    impl::SortScratch<T> scratch(size / 2 + 1);
+    for(size_t width = impl::MERGE_SORT_RUN; width < size; width *= 2) {
+        for(size_t low = 0; low + width < size; low += width * 2) {
+            size_t high = low + width * 2 < size ? low + width * 2 : size;
+            impl::merge_runs(data + low, data + low + width, data + high, scratch.data, less);
+        }
+    }
+}
+
+template<typename T>
+void stable_sort(T* data, size_t size) {
+    stable_sort_by(data, size, Less());
+}
+
+/// Stable LSD radix sort on an integer or floating point key extracted from each element. Keys of up to 32 bits
+/// are sorted one byte per pass; 64-bit keys use 11-bit digits, which takes 6 passes instead of 8. Passes in
+/// which every key has the same digit are skipped. Small inputs go to stable_sort_by instead.
+/// Floats are ordered by their bits, so -0.0 sorts before 0.0 and NaNs go to the ends.
+template<typename T, typename F>
+void radix_sort_by_key(T* data, size_t size, F key) {
+    static_assert(std::is_trivially_copyable_v<T>, "radix sort moves elements around with plain copies");
+    using K = std::decay_t<decltype(key(*data))>;
+    static_assert(RadixKey<K>, "radix sort keys must be integers or floating point numbers");
+    constexpr size_t DIGIT_BITS = sizeof(K) > 4 ? 11 : 8;
+    constexpr size_t NUM_DIGITS = (size_t)1 << DIGIT_BITS;
+    constexpr size_t DIGIT_MASK = NUM_DIGITS - 1;
+    constexpr size_t NUM_PASSES = (sizeof(K) * 8 + DIGIT_BITS - 1) / DIGIT_BITS;
+
+    if(size < impl::RADIX_SORT_THRESHOLD) {
+        stable_sort_by(data, size, [&](const T& a, const T& b) { return impl::radix_bits(key(a)) < impl::radix_bits(key(b)); });
+        return;
+    }
+
+    // The counts take 8 KB for keys of up to 32 bits, which goes on the stack, and 96 KB for 64-bit keys, which
+    // comes from the context allocator. Either would use up most of the temp allocator.
+    constexpr size_t NUM_COUNTS = NUM_PASSES * NUM_DIGITS;
+    constexpr bool COUNTS_ON_STACK = sizeof(K) <= 4;
+    size_t stack_counts[COUNTS_ON_STACK ? NUM_COUNTS : 1];
+    size_t* counts = stack_counts;
+    if constexpr(!COUNTS_ON_STACK) {
+        counts = (size_t*)zw_alloc(sizeof(size_t) * NUM_COUNTS, alignof(size_t));
+        assert(counts && "allocator out of memory");
+    }
+    zw_defer(if constexpr(!COUNTS_ON_STACK) zw_free(counts));
+
+    memset(counts, 0, sizeof(size_t) * NUM_COUNTS);
+    for(size_t i = 0; i < size; i++) {
+        auto bits = impl::radix_bits(key(data[i]));
+        for(size_t pass = 0; pass < NUM_PASSES; pass++) {
+            counts[pass * NUM_DIGITS + ((bits >> (pass * DIGIT_BITS)) & DIGIT_MASK)]++;
+        }
+    }
+
+    impl::SortScratch<T> scratch(size);
+    T* src = data;
+    T* dst = scratch.data;
+    for(size_t pass = 0; pass < NUM_PASSES; pass++) {
+        size_t* offsets = counts + pass * NUM_DIGITS;
+        size_t shift = pass * DIGIT_BITS;
+        if(offsets[(impl::radix_bits(key(src[0])) >> shift) & DIGIT_MASK] == size) continue;
+
+        // Turn the counts into starting offsets in place
+        size_t total = 0;
+        for(size_t digit = 0; digit < NUM_DIGITS; digit++) {
+            size_t count = offsets[digit];
+            offsets[digit] = total;
+            total += count;
+        }
+        for(size_t i = 0; i < size; i++) {
+            size_t digit = (impl::radix_bits(key(src[i])) >> shift) & DIGIT_MASK;
+            memcpy(&dst[offsets[digit]++], &src[i], sizeof(T));
+        }
+        std::swap(src, dst);
+    }
+    if(src != data) {
+        memcpy(data, src, sizeof(T) * size);
+    }
+}
+
+template<RadixKey T>
+void radix_sort(T* data, size_t size) {
+    radix_sort_by_key(data, size, [](T value) { return value; });
+}
+
+};
@@ -1,12 +1,18 @@
 #pragma once
 
 #include <assert.h>
-#include <windows.h>
-#include <stringapiset.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+#include <wctype.h>
 
 #include "array.h"
+#include "option.h"
 #include "range.h"
 #include "context.h"
+#include "string_search.h"
+#include "string_split.h"
+#include "unicode.h"
 
 namespace zw {
 
@@ -40,31 +46,68 @@ namespace priv {
     }
 };
 
+namespace impl {
+    inline Option<size_t> search_result(size_t index) {
+        if(index == NOT_FOUND) return {};
+        return index;
+    }
+
+    template<typename Char>
+    bool equal_ignoring_case(const Char* a, const Char* b, size_t size) {
+        size_t i = 0;
+        if constexpr(sizeof(Char) == 1) {
+            // Settles everything up to the first non-ASCII byte without calling tolower
+            i = ascii_prefix_equal_ignoring_case(a, b, size);
+            if(i == NOT_FOUND) return false;
+        }
+        for(; i < size; i++) {
+            if(a[i] != b[i] && priv::to_lower(a[i]) != priv::to_lower(b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
 template<typename Char>
 class GenericStringSlice {
     const Char* _data = 0;
+    // The size, with NULL_TERMINATED in the top bit when _data[size()] is known to be a null terminator. A
+    // separate flag would make slices too big to pass around in two registers.
     size_t _size = 0;
 
+    static constexpr size_t NULL_TERMINATED = (size_t)1 << (sizeof(size_t) * 8 - 1);
+
+    friend struct OptionNiche<GenericStringSlice<Char>>;
+
 public:
     constexpr GenericStringSlice() = default;
     constexpr GenericStringSlice(const Char* data, size_t size) : _data(data), _size(size) {}
+    /// Pass true for is_null_terminated only if data[size] is 0.
+    constexpr GenericStringSlice(const Char* data, size_t size, bool is_null_terminated) : _data(data), _size(size | (is_null_terminated ? NULL_TERMINATED : 0)) {
+        assert(!is_null_terminated || data[size] == 0);
+    }
+    /// Slices of C strings, including string literals, are null-terminated by construction, so this is also
+    /// known at compile time for constexpr slices.
     constexpr GenericStringSlice(const Char* c_string) : _data(c_string) {
-        _size = impl::c_str_size(c_string);
+        _size = impl::c_str_size(c_string) | (c_string ? NULL_TERMINATED : 0);
     }
 
-    const Char* data() const { return _data; }
-    size_t size() const { return _size; }
-    Range indices() const { return Range(_size); }
+    constexpr const Char* data() const { return _data; }
+    constexpr size_t size() const { return _size & ~NULL_TERMINATED; }
+    constexpr bool is_null_terminated() const { return (_size & NULL_TERMINATED) != 0; }
+    Range indices() const { return Range(size()); }
 
     constexpr Char operator[](size_t i) const {
-        assert(i < _size);
+        assert(i < size());
         return _data[i];
     }
 
     constexpr GenericStringSlice operator[](Range range) const {
-        assert(range.upper_bound <= _size);
+        assert(range.upper_bound <= size());
         assert(range.lower_bound <= range.upper_bound);
-        return {&_data[range.lower_bound], range.upper_bound - range.lower_bound};
+        // A suffix keeps the terminator
+        return {&_data[range.lower_bound], range.upper_bound - range.lower_bound, is_null_terminated() && range.upper_bound == size()};
     }
 
     NoDestruct<GenericString<Char>> c_string() const {
@@ -73,66 +116,155 @@ public:
         return std::move(val);
     }
 
-    // TODO: is this syntax really necessary?
-    template<typename Char=Char>
-    requires std::same_as<Char, char>
-    NoDestruct<WideString> to_wide_string() const {
+    /// A null-terminated pointer to the contents: data() itself if the slice is already null-terminated,
+    /// otherwise a copy made with the temp allocator.
+    const Char* c_str_or_copy() const {
+        if(is_null_terminated()) return _data;
+        if(!size()) {
+            constexpr static Char EMPTY[1] = {};
+            return EMPTY;
+        }
+        Char* copy = (Char*)zw_temp_alloc(sizeof(Char) * (size() + 1), alignof(Char));
+        assert(copy && "allocator out of memory");
+        memcpy(copy, _data, sizeof(Char) * size());
+        copy[size()] = 0;
+        return copy;
+    }
+
+    // The return types are deduced because the string types aren't complete yet
+    template<typename C=Char>
+    requires std::same_as<C, char>
+    auto to_wide_string() const {
         use_temp_allocator();
         WideString val = *this;
-        return std::move(val);
+        return NoDestruct<WideString>(std::move(val));
     }
 
-    template<typename Char=Char>
-    requires std::same_as<Char, wchar_t>
-    NoDestruct<String> to_narrow_string() const {
+    template<typename C=Char>
+    requires std::same_as<C, wchar_t>
+    auto to_narrow_string() const {
         use_temp_allocator();
         String val = *this;
-        return std::move(val);
+        return NoDestruct<String>(std::move(val));
     }
 
     bool starts_with(GenericStringSlice<Char> other) const {
-        if(other._size > _size) return false;
+        if(other.size() > size()) return false;
 
-        return memcmp(_data, other._data, sizeof(Char) * other._size) == 0;
+        return memcmp(_data, other._data, sizeof(Char) * other.size()) == 0;
     }
     bool starts_with_ignoring_case(GenericStringSlice<Char> other) const {
-        if(other._size > _size) return false;
-
-        for(auto i: other.indices()) {
-            if(priv::to_lower(other[i]) != priv::to_lower((*this)[i])) {
-                return false;
-            }
-        }
+        if(other.size() > size()) return false;
 
-        return true;
+        return impl::equal_ignoring_case(_data, other._data, other.size());
     }
     bool ends_with(GenericStringSlice<Char> other) const {
-        if(other._size > _size) return false;
+        if(other.size() > size()) return false;
 
-        return memcmp(_data + _size - other._size, other._data, sizeof(Char) * other._size) == 0;
+        return memcmp(_data + size() - other.size(), other._data, sizeof(Char) * other.size()) == 0;
     }
     bool ends_with_ignoring_case(GenericStringSlice<Char> other) const {
-        if(other._size > _size) return false;
+        if(other.size() > size()) return false;
 
-        size_t begin = _size - other._size;
-        for(auto i: Range(begin, _size)) {
-            if(priv::to_lower(other[i - begin]) != priv::to_lower((*this)[i])) {
-                return false;
-            }
+        return impl::equal_ignoring_case(_data + size() - other.size(), other._data, other.size());
+    }
+    bool is_equal_to_ignoring_case(GenericStringSlice<Char> other) const {
+        return (size() == other.size()) && impl::equal_ignoring_case(_data, other._data, size());
+    }
+
+    /// Index of the first occurrence of needle, if any.
+    Option<size_t> find(GenericStringSlice<Char> needle) const {
+        return impl::search_result(impl::find_substring(_data, size(), needle._data, needle.size()));
+    }
+    Option<size_t> find(Char c) const {
+        return impl::search_result(impl::find_char(_data, size(), c));
+    }
+    /// Index of the last occurrence of needle, if any.
+    Option<size_t> rfind(GenericStringSlice<Char> needle) const {
+        return impl::search_result(impl::rfind_substring(_data, size(), needle._data, needle.size()));
+    }
+    Option<size_t> rfind(Char c) const {
+        return impl::search_result(impl::rfind_char(_data, size(), c));
+    }
+    /// Index of the first character that is one of chars, if any.
+    Option<size_t> find_any_of(GenericStringSlice<Char> chars) const {
+        return impl::search_result(impl::find_any_of(_data, size(), chars._data, chars.size()));
+    }
+    bool contains(GenericStringSlice<Char> needle) const {
+        return impl::find_substring(_data, size(), needle._data, needle.size()) != impl::NOT_FOUND;
+    }
+    bool contains(Char c) const {
+        return impl::find_char(_data, size(), c) != impl::NOT_FOUND;
+    }
+    /// Number of non-overlapping occurrences of needle, which must not be empty.
+    size_t count(GenericStringSlice<Char> needle) const {
+        assert(needle.size());
+        size_t result = 0;
+        size_t begin = 0;
+        for(;;) {
+            size_t index = impl::find_substring(_data + begin, size() - begin, needle._data, needle.size());
+            if(index == impl::NOT_FOUND) return result;
+            result++;
+            begin += index + needle.size();
         }
+    }
 
-        return true;
+    /// Iterates over the pieces between occurrences of delimiter, including empty ones: "a,,b" splits on ','
+    /// into "a", "" and "b", and an empty string yields a single empty piece.
+    SplitIterable<Char> split(Char delimiter) const {
+        return SplitIterable<Char>(_data, size(), is_null_terminated(), &delimiter, 1, impl::SPLIT_UNLIMITED);
     }
-    bool is_equal_to_ignoring_case(GenericStringSlice<Char> other) const {
-        return (_size == other._size) && starts_with_ignoring_case(other);
+    /// The delimiter must not be empty, and must outlive the iteration.
+    SplitIterable<Char> split(GenericStringSlice<Char> delimiter) const {
+        return SplitIterable<Char>(_data, size(), is_null_terminated(), delimiter._data, delimiter.size(), impl::SPLIT_UNLIMITED);
+    }
+    /// Like split(), but yields at most max_pieces pieces, the last of which is the rest of the string.
+    SplitIterable<Char> split_n(Char delimiter, size_t max_pieces) const {
+        return SplitIterable<Char>(_data, size(), is_null_terminated(), &delimiter, 1, max_pieces);
+    }
+    SplitIterable<Char> split_n(GenericStringSlice<Char> delimiter, size_t max_pieces) const {
+        return SplitIterable<Char>(_data, size(), is_null_terminated(), delimiter._data, delimiter.size(), max_pieces);
+    }
+    /// Iterates over the non-empty runs of characters between ASCII whitespace.
+    WhitespaceSplitIterable<Char> split_whitespace() const {
+        return WhitespaceSplitIterable<Char>(_data, size(), is_null_terminated());
     }
+    /// Iterates over the lines, split on "\n" or "\r\n", without their line endings. A line ending at the very
+    /// end doesn't start another, empty line.
+    LinesIterable<Char> lines() const {
+        return LinesIterable<Char>(_data, size(), is_null_terminated());
+    }
+
     bool operator==(GenericStringSlice<Char> other) const {
-        if(_size != other._size) return false;
+        if(size() != other.size()) return false;
 
-        return memcmp(_data, other._data, sizeof(Char) * _size) == 0;
+        return memcmp(_data, other._data, sizeof(Char) * size()) == 0;
+    }
+    /// Lexicographic comparison by code unit. Returns a negative number, zero or a positive number.
+    int compare(GenericStringSlice<Char> other) const {
+        size_t common = size() < other.size() ? size() : other.size();
+        if constexpr(sizeof(Char) == 1) {
+            if(int result = memcmp(_data, other._data, common)) return result;
+        } else {
+            for(auto i: Range(common)) {
+                if(_data[i] != other._data[i]) return _data[i] < other._data[i] ? -1 : 1;
+            }
+        }
+        return size() < other.size() ? -1 : (size() > other.size() ? 1 : 0);
+    }
+    bool operator<(GenericStringSlice<Char> other) const {
+        return compare(other) < 0;
     }
 };
 
+/// No slice can span the whole address space.
+template<typename Char>
+struct OptionNiche<GenericStringSlice<Char>> {
+    static constexpr bool HAS_NICHE = true;
+    static void set_none(GenericStringSlice<Char>* storage) { storage->_size = SIZE_MAX; }
+    static bool is_none(const GenericStringSlice<Char>* storage) { return storage->_size == SIZE_MAX; }
+};
+
 template<typename T, typename Char>
 concept StringConcept = requires(const T& str) {
     { str.data() } -> std::same_as<const Char*>;
@@ -142,18 +274,70 @@ concept StringConcept = requires(const T& str) {
 using StringSlice = GenericStringSlice<char>;
 using WideStringSlice = GenericStringSlice<wchar_t>;
 
+// Slices are passed by value everywhere, which is cheapest when they fit in two registers
+static_assert(sizeof(StringSlice) == 2 * sizeof(void*));
+
 template<typename Char>
-class GenericString {
-    Array<Char> characters;
+class GenericString: ZwObject {
+    struct HeapRep {
+        Char* data;
+        size_t size;
+        size_t cap;
+    };
+    constexpr static size_t INLINE_SLOTS = sizeof(HeapRep) / sizeof(Char);
+    constexpr static uint8_t INLINE_TAG = 0x80;
+    constexpr static uint8_t NONE_TAG = 0xFF;
+    static_assert((NONE_TAG & ~INLINE_TAG) > INLINE_SLOTS);
+
+    friend struct OptionNiche<GenericString<Char>>;
+
 public:
-    GenericString() = default;
+    /// Strings of up to this many characters are stored inside the object, without allocating.
+    constexpr static size_t INLINE_CAPACITY = INLINE_SLOTS - 2;
+
+private:
+    // The last byte of the object tells the two representations apart. An inline string keeps its size there
+    // with the top bit set. A heap string has the top byte of its (little-endian) capacity there, and the top
+    // bit of a capacity is never set. NONE_TAG, which would be an inline size greater than INLINE_CAPACITY,
+    // is free for Option to use.
+    union {
+        HeapRep _heap;
+        Char _inline[INLINE_SLOTS];
+        uint8_t _bytes[sizeof(HeapRep)];
+    };
+
+    uint8_t tag() const { return _bytes[sizeof(HeapRep) - 1]; }
+    bool is_inline() const { return tag() & INLINE_TAG; }
+
+    void init_empty() {
+        _bytes[sizeof(HeapRep) - 1] = INLINE_TAG;
+        _inline[0] = 0;
+    }
+
+    // Sets the size without touching the contents, other than writing the null terminator.
+    void set_size(size_t size) {
+        if(is_inline()) {
+            assert(size <= INLINE_CAPACITY);
+            _inline[size] = 0;
+            _bytes[sizeof(HeapRep) - 1] = INLINE_TAG | (uint8_t)size;
+        } else {
+            assert(size <= _heap.cap);
+            _heap.data[size] = 0;
+            _heap.size = size;
+        }
+    }
+
+public:
+    GenericString() {
+        init_empty();
+    }
     GenericString(GenericStringSlice<Char> slice) {
+        init_empty();
         if(slice.size()) {
             assert(slice.data());
-            characters.reserve(slice.size() + 1);
-            memcpy(characters.data(), slice.data(), slice.size() * sizeof(Char));
-            characters.unsafe_set_size(slice.size() + 1);
-            characters[slice.size()] = 0;
+            reserve(slice.size());
+            memcpy(data(), slice.data(), slice.size() * sizeof(Char));
+            set_size(slice.size());
         }
     }
 
@@ -162,67 +346,143 @@ public:
     /// This overload exists in order to support converting from std::string, std::wstring, std::vector<Char> or even zw::Array<Char>
     GenericString(const StringConcept<Char> auto& str) : GenericString(GenericStringSlice<Char>{str.data(), str.size()}) {}
 
-    template<typename Char=Char>
-    requires std::same_as<Char, char>
+    template<typename C=Char>
+    requires std::same_as<C, char>
     GenericString(WideStringSlice wide_string) {
-        int length = WideCharToMultiByte(CP_UTF8, 0, wide_string.data(), (int)wide_string.size(), nullptr, 0, nullptr, nullptr);
-        characters.reserve(length + 1);
-        int code = WideCharToMultiByte(CP_UTF8, 0, wide_string.data(), -1, characters.data(), length, nullptr, nullptr);
-        characters.unsafe_set_size(length);
-        characters[size()] = 0;
-    }
-    template<typename Char=Char>
-    requires std::same_as<Char, char>
+        init_empty();
+        append(wide_string);
+    }
+    template<typename C=Char>
+    requires std::same_as<C, char>
     GenericString(const wchar_t* wide_string) : GenericString(WideStringSlice(wide_string)) {}
-    
 
-    template<typename Char=Char>
-    requires std::same_as<Char, wchar_t>
-    GenericString(const char* narrow_string) {
-        fflush(stdout);
-        int length = MultiByteToWideChar(CP_UTF8, MB_PRECOMPOSED, narrow_string, -1, nullptr, 0);
-        characters.reserve(length);
-        int code = MultiByteToWideChar(CP_UTF8, MB_PRECOMPOSED, narrow_string, -1, characters.data(), length);
-        characters.unsafe_set_size(length);
-    }
+    template<typename C=Char>
+    requires std::same_as<C, wchar_t>
+    GenericString(const char* narrow_string) : GenericString(StringSlice(narrow_string)) {}
 
-    template<typename Char=Char>
-    requires std::same_as<Char, wchar_t>
+    template<typename C=Char>
+    requires std::same_as<C, wchar_t>
     GenericString(StringSlice narrow_string) {
-        // TODO: efficiency. It would be nice if StringSlice had a way of knowing if it were null-terminated or not...
-        auto null_terminated = narrow_string.c_string();
-        *this = null_terminated->data();
+        init_empty();
+        append(narrow_string);
+    }
+
+    GenericString(const GenericString<Char>& other) : ZwObject(other) {
+        init_empty();
+        append(other);
+    }
+    GenericString(GenericString<Char>&& other) noexcept {
+        memcpy(_bytes, other._bytes, sizeof(HeapRep));
+        other.init_empty();
+    }
+
+    GenericString<Char>& operator=(const GenericString<Char>& other) {
+        if(this != &other) {
+            GenericString<Char> temp = other;
+            swap(*this, temp);
+        }
+        return *this;
+    }
+
+    GenericString<Char>& operator=(GenericString<Char>&& other) {
+        if(this != &other) {
+            GenericString<Char> temp = std::move(other);
+            swap(*this, temp);
+        }
+        return *this;
     }
 
-    const Char* data() const { return characters.data(); }
-    Char* data() { return characters.data(); }
-    size_t size() const { return characters.size() ? characters.size() - 1 : 0; }
+    ~GenericString() {
+        if(!is_inline()) {
+            zw_free(_heap.data);
+        }
+    }
+
+    const Char* data() const { return is_inline() ? _inline : _heap.data; }
+    Char* data() { return is_inline() ? _inline : _heap.data; }
+    size_t size() const { return is_inline() ? tag() & ~INLINE_TAG : _heap.size; }
+    /// Number of characters that fit without reallocating, not counting the null terminator.
+    size_t cap() const { return is_inline() ? INLINE_CAPACITY : _heap.cap; }
     Range indices() const { return Range(size()); }
     operator GenericStringSlice<Char>() const {
-        return GenericStringSlice<Char>(data(), size());
+        return GenericStringSlice<Char>(data(), size(), true);
     }
     GenericStringSlice<Char> as_slice() const {
         return *this;
     }
 
+    /// Makes room for min_cap characters plus the null terminator, moving to the context allocator if they
+    /// don't fit inline.
+    void reserve(size_t min_cap) {
+        if(min_cap <= cap()) return;
+
+        size_t new_cap = cap() * 2;
+        if(new_cap < min_cap) {
+            new_cap = min_cap;
+        }
+        if(is_inline()) {
+            size_t size = this->size();
+            Char* heap_data = (Char*)zw_alloc(sizeof(Char) * (new_cap + 1), alignof(Char));
+            assert(heap_data && "allocator out of memory");
+            memcpy(heap_data, _inline, sizeof(Char) * (size + 1));
+            _heap = HeapRep { heap_data, size, new_cap };
+        } else {
+            _heap.data = (Char*)zw_realloc(_heap.data, sizeof(Char) * (new_cap + 1), alignof(Char));
+            assert(_heap.data && "allocator out of memory");
+            _heap.cap = new_cap;
+        }
+    }
+
     void append(GenericStringSlice<Char> slice) {
         if(slice.size()) {
             assert(slice.data());
             size_t og_size = size();
             size_t new_size = og_size + slice.size();
-            characters.reserve(new_size + 1);
-            memcpy(characters.data() + og_size, slice.data(), slice.size() * sizeof(Char));
-            characters.unsafe_set_size(new_size + 1);
-            characters[new_size] = 0;
+            reserve(new_size);
+            memcpy(data() + og_size, slice.data(), slice.size() * sizeof(Char));
+            set_size(new_size);
+        }
+    }
+    /// Appends a string of the other character type, converting between UTF-8 and UTF-16/32. The converted
+    /// length is computed first, so this allocates at most once.
+    void append(GenericStringSlice<std::conditional_t<std::same_as<Char, char>, wchar_t, char>> slice) {
+        if(slice.size()) {
+            assert(slice.data());
+            size_t og_size = size();
+            size_t new_size;
+            if constexpr(std::same_as<Char, char>) {
+                new_size = og_size + wide_to_utf8_length(slice.data(), slice.size());
+                reserve(new_size);
+                wide_to_utf8(slice.data(), slice.size(), data() + og_size);
+            } else {
+                new_size = og_size + utf8_to_wide_length(slice.data(), slice.size());
+                reserve(new_size);
+                utf8_to_wide(slice.data(), slice.size(), data() + og_size);
+            }
+            set_size(new_size);
         }
     }
     void push(Char c) {
-        characters[size()] = c;
-        characters.push(0);
+        size_t og_size = size();
+        reserve(og_size + 1);
+        data()[og_size] = c;
+        set_size(og_size + 1);
     }
+    /// New characters are zeroed.
     void resize(size_t new_size) {
-        characters.resize(new_size + 1);
-        characters[size()] = 0;
+        size_t og_size = size();
+        reserve(new_size);
+        if(new_size > og_size) {
+            memset(data() + og_size, 0, (new_size - og_size) * sizeof(Char));
+        }
+        set_size(new_size);
+    }
+
+    friend void swap(GenericString<Char>& left, GenericString<Char>& right) {
+        uint8_t temp[sizeof(HeapRep)];
+        memcpy(temp, left._bytes, sizeof(HeapRep));
+        memcpy(left._bytes, right._bytes, sizeof(HeapRep));
+        memcpy(right._bytes, temp, sizeof(HeapRep));
     }
 
     bool starts_with(GenericStringSlice<Char> slice) const {
@@ -243,6 +503,25 @@ public:
     bool operator==(GenericStringSlice<Char> slice) const {
         return as_slice() == slice;
     }
+    int compare(GenericStringSlice<Char> slice) const {
+        return as_slice().compare(slice);
+    }
+    bool operator<(GenericStringSlice<Char> slice) const {
+        return as_slice() < slice;
+    }
 };
 
-};
\ No newline at end of file
+template<typename Char>
+struct OptionNiche<GenericString<Char>> {
+    static constexpr bool HAS_NICHE = true;
+    static void set_none(GenericString<Char>* storage) {
+        storage->_bytes[sizeof(typename GenericString<Char>::HeapRep) - 1] = GenericString<Char>::NONE_TAG;
+    }
+    static bool is_none(const GenericString<Char>* storage) { return storage->tag() == GenericString<Char>::NONE_TAG; }
+};
+
+static_assert(sizeof(Option<StringSlice>) == sizeof(StringSlice));
+static_assert(sizeof(Option<String>) == sizeof(String));
+static_assert(sizeof(Option<WideString>) == sizeof(WideString));
+
+};
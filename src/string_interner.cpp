@@ -0,0 +1,163 @@
+#include <bit>
+#include <mutex>
+
+#include "string_interner.h"
+#include "misc.h"
+
+namespace zw {
+
+constexpr uint32_t THREAD_SAFE_SHARD_BITS = 4;
+constexpr size_t STRING_CHUNK_SIZE = 64 * 1024;
+
+// Each shard maps its local indices to slices through a list of blocks that double in size, so the table
+// grows without ever moving the slices that other threads may be reading.
+constexpr uint32_t FIRST_BLOCK_BITS = 10;
+constexpr uint32_t MAX_BLOCKS = 33 - FIRST_BLOCK_BITS;
+
+static uint32_t block_of(uint32_t index) {
+    return index < (1u << FIRST_BLOCK_BITS) ? 0 : std::bit_width(index) - FIRST_BLOCK_BITS;
+}
+static uint32_t block_start(uint32_t block) {
+    return block ? 1u << (FIRST_BLOCK_BITS + block - 1) : 0;
+}
+static uint32_t block_size(uint32_t block) {
+    return 1u << (block ? FIRST_BLOCK_BITS + block - 1 : FIRST_BLOCK_BITS);
+}
+
+struct alignas(CACHE_LINE_SIZE) StringInterner::Shard {
+    std::mutex lock;
+    HashMap<StringSlice, uint32_t> indices;
+    StringSlice* blocks[MAX_BLOCKS] = {};
+    uint32_t count = 0;
+
+    // Every chunk starts with a pointer to the previously allocated one
+    void* chunks = nullptr;
+    char* cursor = nullptr;
+    char* cursor_end = nullptr;
+
+    char* alloc_chunk(Allocator* allocator, size_t size) {
+        void** chunk = (void**)zw_alloc(allocator, sizeof(void*) + size, alignof(void*));
+        assert(chunk && "allocator out of memory");
+        *chunk = chunks;
+        chunks = chunk;
+        return (char*)(chunk + 1);
+    }
+
+    const char* store(Allocator* allocator, StringSlice string) {
+        size_t size = string.size() + 1;
+        char* dest;
+        if(size > STRING_CHUNK_SIZE / 4) {
+            // Big strings get a chunk to themselves, so they don't waste the rest of the current one
+            dest = alloc_chunk(allocator, size);
+        } else {
+            if((size_t)(cursor_end - cursor) < size) {
+                cursor = alloc_chunk(allocator, STRING_CHUNK_SIZE);
+                cursor_end = cursor + STRING_CHUNK_SIZE;
+            }
+            dest = cursor;
+            cursor += size;
+        }
+        memcpy(dest, string.data(), string.size());
+        dest[string.size()] = 0;
+        return dest;
+    }
+
+    void free_memory(Allocator* allocator) {
+        for(auto block: Range(MAX_BLOCKS)) {
+            if(blocks[block]) {
+                zw_free(allocator, blocks[block]);
+            }
+        }
+        while(chunks) {
+            void* next = *(void**)chunks;
+            zw_free(allocator, chunks);
+            chunks = next;
+        }
+    }
+};
+
+StringInterner::StringInterner(bool is_thread_safe, Allocator* allocator) : _allocator(allocator), _is_thread_safe(is_thread_safe) {
+    _shard_bits = is_thread_safe ? THREAD_SAFE_SHARD_BITS : 0;
+    size_t num_shards = (size_t)1 << _shard_bits;
+    _shards = (Shard*)zw_alloc(_allocator, sizeof(Shard) * num_shards, alignof(Shard));
+    assert(_shards && "allocator out of memory");
+    zw_set_ctx(allocator, _allocator);
+    for(auto i: Range(num_shards)) {
+        new(&_shards[i]) Shard();
+    }
+}
+
+StringInterner::~StringInterner() {
+    // The shards' hash maps allocate through the context allocator, so it has to match on the way out too
+    zw_set_ctx(allocator, _allocator);
+    for(auto i: Range((size_t)1 << _shard_bits)) {
+        _shards[i].free_memory(_allocator);
+        _shards[i].~Shard();
+    }
+    zw_free(_allocator, _shards);
+}
+
+StringInterner::Shard& StringInterner::shard_for(StringSlice string) const {
+    if(!_shard_bits) return _shards[0];
+
+    // The hash map indexes by the low bits, so pick the shard with the high ones
+    uint64_t hash = DefaultHasher<StringSlice>::hash(string);
+    return _shards[hash >> (64 - _shard_bits)];
+}
+
+Symbol StringInterner::intern(StringSlice string) {
+    Shard& shard = shard_for(string);
+    if(_is_thread_safe) shard.lock.lock();
+    zw_defer(if(_is_thread_safe) shard.lock.unlock());
+
+    if(auto index = shard.indices.get(string); index.is_present()) {
+        return Symbol { (*index.unwrap() << _shard_bits) | (uint32_t)(&shard - _shards) };
+    }
+
+    uint32_t index = shard.count;
+    // The last index is left unused, so that no symbol has the id reserved for Option<Symbol>
+    assert(index + 1 < (1ull << (32 - _shard_bits)) && "too many interned strings");
+    uint32_t block = block_of(index);
+    if(!shard.blocks[block]) {
+        shard.blocks[block] = (StringSlice*)zw_alloc(_allocator, sizeof(StringSlice) * block_size(block), alignof(StringSlice));
+        assert(shard.blocks[block] && "allocator out of memory");
+    }
+    StringSlice stored(shard.store(_allocator, string), string.size(), true);
+    new(&shard.blocks[block][index - block_start(block)]) StringSlice(stored);
+    shard.count++;
+
+    zw_set_ctx(allocator, _allocator);
+    shard.indices.insert(stored, index);
+    return Symbol { (index << _shard_bits) | (uint32_t)(&shard - _shards) };
+}
+
+Option<Symbol> StringInterner::find(StringSlice string) const {
+    Shard& shard = shard_for(string);
+    if(_is_thread_safe) shard.lock.lock();
+    zw_defer(if(_is_thread_safe) shard.lock.unlock());
+
+    if(auto index = shard.indices.get(string); index.is_present()) {
+        return Symbol { (*index.unwrap() << _shard_bits) | (uint32_t)(&shard - _shards) };
+    }
+    return {};
+}
+
+StringSlice StringInterner::resolve(Symbol symbol) const {
+    const Shard& shard = _shards[symbol.id & ((1u << _shard_bits) - 1)];
+    uint32_t index = symbol.id >> _shard_bits;
+    uint32_t block = block_of(index);
+    return shard.blocks[block][index - block_start(block)];
+}
+
+size_t StringInterner::size() const {
+    size_t size = 0;
+    for(auto i: Range((size_t)1 << _shard_bits)) {
+        Shard& shard = _shards[i];
+        if(_is_thread_safe) shard.lock.lock();
+        size += shard.count;
+        if(_is_thread_safe) shard.lock.unlock();
+    }
+    return size;
+}
+
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "alloc.h"
+#include "hash_map.h"
+#include "option.h"
+#include "string.h"
+
+namespace zw {
+
+/// Handle to a string interned in a StringInterner. Two symbols from the same interner are equal exactly
+/// when their strings are, so comparing and hashing them never touches the characters.
+struct Symbol {
+    uint32_t id;
+
+    bool operator==(Symbol other) const { return id == other.id; }
+    bool operator!=(Symbol other) const { return id != other.id; }
+};
+
+/// Interners never hand out the last id.
+template<>
+struct OptionNiche<Symbol>: SentinelNiche<Symbol, Symbol { UINT32_MAX }> {};
+
+static_assert(sizeof(Option<Symbol>) == sizeof(Symbol));
+
+template<>
+struct DefaultHasher<Symbol> {
+    static uint64_t hash(Symbol symbol) { return impl::hash_mix(symbol.id); }
+};
+
+/// Deduplicating string table. Each unique string is copied once, null-terminated, into large chunks from the
+/// allocator the interner was created with, and stays at the same address until the interner is destroyed,
+/// so the slices returned by resolve() remain valid for its whole lifetime.
+///
+/// In thread-safe mode, strings are spread by hash over several independently locked shards, so threads
+/// interning different strings rarely contend. resolve() never locks: a Symbol can only be obtained after the
+/// string it refers to has been published.
+class StringInterner {
+    struct Shard;
+
+    Allocator* _allocator;
+    Shard* _shards;
+    uint32_t _shard_bits;
+    bool _is_thread_safe;
+
+    Shard& shard_for(StringSlice string) const;
+
+public:
+    explicit StringInterner(bool is_thread_safe = false, Allocator* allocator = zw_get_ctx(allocator));
+    StringInterner(const StringInterner& other) = delete;
+    StringInterner(StringInterner&& other) = delete;
+    ~StringInterner();
+
+    /// Returns the symbol for string, adding a copy of it to the table if it isn't there yet.
+    Symbol intern(StringSlice string);
+    /// Returns the symbol for string if it has been interned, without adding it.
+    Option<Symbol> find(StringSlice string) const;
+    /// The interned string, which is also null-terminated.
+    StringSlice resolve(Symbol symbol) const;
+
+    /// Number of unique strings interned.
+    size_t size() const;
+};
+
+};
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <bit>
+
+#include "macros.h"
+
+#ifdef ZW_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef ZW_AVX2
+#include <immintrin.h>
+#endif
+
+// String search kernels behind GenericStringSlice. All of them take non-null-terminated ranges and return
+// NOT_FOUND when there is no match. The templates are plain loops for any character type; the char overloads
+// are vectorized.
+//
+// Substring search filters candidate positions by comparing a whole block of positions against the first and
+// the last byte of the needle at once, and only runs memcmp on the positions where both match. Real text
+// rarely has many of those, so most blocks are rejected with a handful of instructions.
+
+namespace zw::impl {
+
+constexpr size_t NOT_FOUND = (size_t)-1;
+
+template<typename Char>
+size_t find_char(const Char* haystack, size_t size, Char c) {
+    for(size_t i = 0; i < size; i++) {
+        if(haystack[i] == c) return i;
+    }
+    return NOT_FOUND;
+}
+
+template<typename Char>
+size_t rfind_char(const Char* haystack, size_t size, Char c) {
+    for(size_t i = size; i > 0; i--) {
+        if(haystack[i - 1] == c) return i - 1;
+    }
+    return NOT_FOUND;
+}
+
+template<typename Char>
+size_t find_substring(const Char* haystack, size_t size, const Char* needle, size_t needle_size) {
+    if(needle_size > size) return NOT_FOUND;
+    for(size_t i = 0; i <= size - needle_size; i++) {
+        if(memcmp(haystack + i, needle, needle_size * sizeof(Char)) == 0) return i;
+    }
+    return NOT_FOUND;
+}
+
+template<typename Char>
+size_t rfind_substring(const Char* haystack, size_t size, const Char* needle, size_t needle_size) {
+    if(needle_size > size) return NOT_FOUND;
+    for(size_t i = size - needle_size + 1; i > 0; i--) {
+        if(memcmp(haystack + i - 1, needle, needle_size * sizeof(Char)) == 0) return i - 1;
+    }
+    return NOT_FOUND;
+}
+
+template<typename Char>
+size_t find_any_of(const Char* haystack, size_t size, const Char* set, size_t set_size) {
+    for(size_t i = 0; i < size; i++) {
+        if(find_char(set, set_size, haystack[i]) != NOT_FOUND) return i;
+    }
+    return NOT_FOUND;
+}
+
+inline size_t find_char(const char* haystack, size_t size, char c) {
+    size_t i = 0;
+#ifdef ZW_SSE2
+    __m128i needle = _mm_set1_epi8(c);
+    for(; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(haystack + i));
+        if(uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle))) {
+            return i + std::countr_zero(mask);
+        }
+    }
+#endif
+    for(; i < size; i++) {
+        if(haystack[i] == c) return i;
+    }
+    return NOT_FOUND;
+}
+
+inline size_t rfind_char(const char* haystack, size_t size, char c) {
+    size_t end = size;
+#ifdef ZW_SSE2
+    __m128i needle = _mm_set1_epi8(c);
+    for(; end >= 16; end -= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(haystack + end - 16));
+        if(uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle))) {
+            return end - 16 + (31 - std::countl_zero(mask));
+        }
+    }
+#endif
+    while(end > 0) {
+        end--;
+        if(haystack[end] == c) return end;
+    }
+    return NOT_FOUND;
+}
+
+inline size_t find_substring(const char* haystack, size_t size, const char* needle, size_t needle_size) {
+    if(!needle_size) return 0;
+    if(needle_size > size) return NOT_FOUND;
+    if(needle_size == 1) return find_char(haystack, size, needle[0]);
+
+    // Positions [0, num_positions) are candidate starts
+    size_t num_positions = size - needle_size + 1;
+    size_t i = 0;
+    char first = needle[0];
+    char last = needle[needle_size - 1];
+#ifdef ZW_AVX2
+    __m256i first_256 = _mm256_set1_epi8(first);
+    __m256i last_256 = _mm256_set1_epi8(last);
+    for(; i + 32 <= num_positions; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i*)(haystack + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i*)(haystack + i + needle_size - 1));
+        __m256i matches = _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first_256), _mm256_cmpeq_epi8(block_last, last_256));
+        for(uint32_t mask = (uint32_t)_mm256_movemask_epi8(matches); mask; mask &= mask - 1) {
+            size_t pos = i + std::countr_zero(mask);
+            if(memcmp(haystack + pos + 1, needle + 1, needle_size - 2) == 0) return pos;
+        }
+    }
+#endif
+#ifdef ZW_SSE2
+    __m128i first_128 = _mm_set1_epi8(first);
+    __m128i last_128 = _mm_set1_epi8(last);
+    for(; i + 16 <= num_positions; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i*)(haystack + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(haystack + i + needle_size - 1));
+        __m128i matches = _mm_and_si128(_mm_cmpeq_epi8(block_first, first_128), _mm_cmpeq_epi8(block_last, last_128));
+        for(uint32_t mask = (uint32_t)_mm_movemask_epi8(matches); mask; mask &= mask - 1) {
+            size_t pos = i + std::countr_zero(mask);
+            if(memcmp(haystack + pos + 1, needle + 1, needle_size - 2) == 0) return pos;
+        }
+    }
+#endif
+    for(; i < num_positions; i++) {
+        if(haystack[i] == first && haystack[i + needle_size - 1] == last && memcmp(haystack + i + 1, needle + 1, needle_size - 2) == 0) {
+            return i;
+        }
+    }
+    return NOT_FOUND;
+}
+
+inline size_t rfind_substring(const char* haystack, size_t size, const char* needle, size_t needle_size) {
+    if(!needle_size) return size;
+    if(needle_size > size) return NOT_FOUND;
+    if(needle_size == 1) return rfind_char(haystack, size, needle[0]);
+
+    // Candidate starts [0, end) remain to be checked, from the back
+    size_t end = size - needle_size + 1;
+    char first = needle[0];
+    char last = needle[needle_size - 1];
+#ifdef ZW_SSE2
+    __m128i first_128 = _mm_set1_epi8(first);
+    __m128i last_128 = _mm_set1_epi8(last);
+    for(; end >= 16; end -= 16) {
+        size_t base = end - 16;
+        __m128i block_first = _mm_loadu_si128((const __m128i*)(haystack + base));
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(haystack + base + needle_size - 1));
+        __m128i matches = _mm_and_si128(_mm_cmpeq_epi8(block_first, first_128), _mm_cmpeq_epi8(block_last, last_128));
+        for(uint32_t mask = (uint32_t)_mm_movemask_epi8(matches); mask; ) {
+            uint32_t bit = 31 - std::countl_zero(mask);
+            if(memcmp(haystack + base + bit + 1, needle + 1, needle_size - 2) == 0) return base + bit;
+            mask ^= 1u << bit;
+        }
+    }
+#endif
+    while(end > 0) {
+        end--;
+        if(haystack[end] == first && haystack[end + needle_size - 1] == last && memcmp(haystack + end + 1, needle + 1, needle_size - 2) == 0) {
+            return end;
+        }
+    }
+    return NOT_FOUND;
+}
+
+inline size_t find_any_of(const char* haystack, size_t size, const char* set, size_t set_size) {
+    if(!set_size) return NOT_FOUND;
+    if(set_size == 1) return find_char(haystack, size, set[0]);
+
+    size_t i = 0;
+#ifdef ZW_SSE2
+    // Small sets are compared against directly, a block at a time
+    constexpr size_t MAX_SIMD_SET_SIZE = 8;
+    if(set_size <= MAX_SIMD_SET_SIZE) {
+        __m128i members[MAX_SIMD_SET_SIZE];
+        for(size_t j = 0; j < set_size; j++) {
+            members[j] = _mm_set1_epi8(set[j]);
+        }
+        for(; i + 16 <= size; i += 16) {
+            __m128i block = _mm_loadu_si128((const __m128i*)(haystack + i));
+            __m128i matches = _mm_cmpeq_epi8(block, members[0]);
+            for(size_t j = 1; j < set_size; j++) {
+                matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, members[j]));
+            }
+            if(uint32_t mask = (uint32_t)_mm_movemask_epi8(matches)) {
+                return i + std::countr_zero(mask);
+            }
+        }
+    }
+#endif
+    uint64_t table[4] = {};
+    for(size_t j = 0; j < set_size; j++) {
+        uint8_t c = (uint8_t)set[j];
+        table[c >> 6] |= (uint64_t)1 << (c & 63);
+    }
+    for(; i < size; i++) {
+        uint8_t c = (uint8_t)haystack[i];
+        if((table[c >> 6] >> (c & 63)) & 1) return i;
+    }
+    return NOT_FOUND;
+}
+
+inline char ascii_to_lower(char c) {
+    return (uint8_t)(c - 'A') < 26 ? c + ('a' - 'A') : c;
+}
+
+// Compares size bytes for equality ignoring ASCII case, 16 bytes at a time. Returns the number of leading
+// bytes known to be equal; the caller takes over with locale-aware lowering at that point if it is less than
+// size and the mismatch involves a non-ASCII byte. Returns NOT_FOUND on a definite mismatch.
+inline size_t ascii_prefix_equal_ignoring_case(const char* a, const char* b, size_t size) {
+    size_t i = 0;
+#ifdef ZW_SSE2
+    const __m128i upper_a = _mm_set1_epi8('A');
+    const __m128i letters = _mm_set1_epi8(25);
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    auto to_lower = [&](__m128i x) {
+        // x - 'A' is in [0, 25] exactly for upper-case letters
+        __m128i offset = _mm_sub_epi8(x, upper_a);
+        __m128i is_upper = _mm_cmpeq_epi8(_mm_min_epu8(offset, letters), offset);
+        return _mm_or_si128(x, _mm_and_si128(is_upper, case_bit));
+    };
+    for(; i + 16 <= size; i += 16) {
+        __m128i block_a = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i block_b = _mm_loadu_si128((const __m128i*)(b + i));
+        if(_mm_movemask_epi8(_mm_or_si128(block_a, block_b))) {
+            // Non-ASCII bytes somewhere in this block
+            break;
+        }
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(to_lower(block_a), to_lower(block_b))) != 0xFFFF) {
+            return NOT_FOUND;
+        }
+    }
+#endif
+    for(; i < size; i++) {
+        if((a[i] | b[i]) & 0x80) return i;
+        if(ascii_to_lower(a[i]) != ascii_to_lower(b[i])) return NOT_FOUND;
+    }
+    return i;
+}
+
+};
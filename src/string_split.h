@@ -0,0 +1,222 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "iter.h"
+#include "string_search.h"
+
+// Lazy splitting of string slices, returned by GenericStringSlice::split() and friends. The pieces are
+// sub-slices of the original string, so nothing is copied or allocated, and delimiters are found with the
+// vectorized search kernels. A piece that runs to the end of a null-terminated string is null-terminated too.
+
+namespace zw {
+
+template<typename Char>
+class GenericStringSlice;
+
+namespace impl {
+    constexpr size_t SPLIT_DONE = (size_t)-1;
+    constexpr size_t SPLIT_UNLIMITED = (size_t)-1;
+
+    template<typename Char>
+    constexpr Char WHITESPACE[] = {' ', '\t', '\n', '\r', '\v', '\f'};
+
+    template<typename Char>
+    bool is_whitespace(Char c) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+};
+
+template<typename Char>
+class SplitIterator {
+    const Char* data;
+    size_t size;
+    bool is_null_terminated;
+    const Char* delimiter;
+    size_t delimiter_size;
+    Char delimiter_char;
+    // Number of pieces left to yield before the rest of the string is yielded whole
+    size_t remaining;
+    // The current piece is [pos, end), or pos is SPLIT_DONE past the last piece
+    size_t pos;
+    size_t end;
+
+    void find_end() {
+        if(remaining == 1) {
+            end = size;
+            return;
+        }
+        size_t index = delimiter_size == 1 ?
+            impl::find_char(data + pos, size - pos, delimiter_char) :
+            impl::find_substring(data + pos, size - pos, delimiter, delimiter_size);
+        end = index == impl::NOT_FOUND ? size : pos + index;
+    }
+public:
+    using Element = GenericStringSlice<Char>;
+
+    SplitIterator(const Char* data, size_t size, bool is_null_terminated, const Char* delimiter, size_t delimiter_size, size_t max_pieces, size_t pos) :
+        data(data), size(size), is_null_terminated(is_null_terminated), delimiter(delimiter), delimiter_size(delimiter_size), delimiter_char(delimiter[0]), remaining(max_pieces), pos(pos) {
+        if(!max_pieces) {
+            this->pos = impl::SPLIT_DONE;
+        }
+        if(this->pos != impl::SPLIT_DONE) {
+            find_end();
+        }
+    }
+
+    SplitIterator<Char>& operator++() {
+        if(end == size) {
+            pos = impl::SPLIT_DONE;
+        } else {
+            pos = end + delimiter_size;
+            if(remaining != impl::SPLIT_UNLIMITED) {
+                remaining--;
+            }
+            find_end();
+        }
+        return *this;
+    }
+
+    bool operator==(const SplitIterator<Char>& other) const { return pos == other.pos; }
+    bool operator!=(const SplitIterator<Char>& other) const { return pos != other.pos; }
+    Element operator*() { return Element(data + pos, end - pos, is_null_terminated && end == size); }
+};
+
+template<typename Char>
+class SplitIterable: public Iterable<SplitIterable<Char>> {
+    const Char* data;
+    size_t size;
+    bool is_null_terminated;
+    const Char* delimiter;
+    size_t delimiter_size;
+    Char delimiter_char;
+    size_t max_pieces;
+public:
+    using Iterator = SplitIterator<Char>;
+
+    SplitIterable(const Char* data, size_t size, bool is_null_terminated, const Char* delimiter, size_t delimiter_size, size_t max_pieces) :
+        data(data), size(size), is_null_terminated(is_null_terminated), delimiter(delimiter), delimiter_size(delimiter_size), max_pieces(max_pieces) {
+        assert(delimiter_size && "split delimiter must not be empty");
+        // Keeps single-character delimiters alive for iterators that outlive the call to split()
+        delimiter_char = delimiter[0];
+        if(delimiter_size == 1) {
+            this->delimiter = nullptr;
+        }
+    }
+    Iterator begin() const { return Iterator(data, size, is_null_terminated, delimiter ? delimiter : &delimiter_char, delimiter_size, max_pieces, 0); }
+    Iterator end() const { return Iterator(data, size, is_null_terminated, delimiter ? delimiter : &delimiter_char, delimiter_size, max_pieces, impl::SPLIT_DONE); }
+    size_t size_hint() const { return max_pieces ? 1 : 0; }
+};
+
+template<typename Char>
+class WhitespaceSplitIterator {
+    const Char* data;
+    size_t size;
+    bool is_null_terminated;
+    // The current token is [pos, end), or pos is SPLIT_DONE past the last token
+    size_t pos;
+    size_t end;
+
+    void find_token(size_t from) {
+        while(from < size && impl::is_whitespace(data[from])) {
+            from++;
+        }
+        if(from == size) {
+            pos = impl::SPLIT_DONE;
+            return;
+        }
+        pos = from;
+        size_t index = impl::find_any_of(data + pos, size - pos, impl::WHITESPACE<Char>, sizeof(impl::WHITESPACE<Char>) / sizeof(Char));
+        end = index == impl::NOT_FOUND ? size : pos + index;
+    }
+public:
+    using Element = GenericStringSlice<Char>;
+
+    WhitespaceSplitIterator(const Char* data, size_t size, bool is_null_terminated, size_t pos) : data(data), size(size), is_null_terminated(is_null_terminated), pos(pos) {
+        if(pos != impl::SPLIT_DONE) {
+            find_token(pos);
+        }
+    }
+
+    WhitespaceSplitIterator<Char>& operator++() {
+        find_token(end);
+        return *this;
+    }
+
+    bool operator==(const WhitespaceSplitIterator<Char>& other) const { return pos == other.pos; }
+    bool operator!=(const WhitespaceSplitIterator<Char>& other) const { return pos != other.pos; }
+    Element operator*() { return Element(data + pos, end - pos, is_null_terminated && end == size); }
+};
+
+template<typename Char>
+class WhitespaceSplitIterable: public Iterable<WhitespaceSplitIterable<Char>> {
+    const Char* data;
+    size_t size;
+    bool is_null_terminated;
+public:
+    using Iterator = WhitespaceSplitIterator<Char>;
+
+    WhitespaceSplitIterable(const Char* data, size_t size, bool is_null_terminated) : data(data), size(size), is_null_terminated(is_null_terminated) {}
+    Iterator begin() const { return Iterator(data, size, is_null_terminated, 0); }
+    Iterator end() const { return Iterator(data, size, is_null_terminated, impl::SPLIT_DONE); }
+};
+
+template<typename Char>
+class LinesIterator {
+    const Char* data;
+    size_t size;
+    bool is_null_terminated;
+    // The current line is [pos, end) not counting its line ending, or pos is SPLIT_DONE past the last line
+    size_t pos;
+    size_t end;
+
+    void find_line(size_t from) {
+        // A line ending at the very end doesn't start another, empty line
+        if(from == size) {
+            pos = impl::SPLIT_DONE;
+            return;
+        }
+        pos = from;
+        size_t index = impl::find_char(data + pos, size - pos, (Char)'\n');
+        end = index == impl::NOT_FOUND ? size : pos + index;
+    }
+public:
+    using Element = GenericStringSlice<Char>;
+
+    LinesIterator(const Char* data, size_t size, bool is_null_terminated, size_t pos) : data(data), size(size), is_null_terminated(is_null_terminated), pos(pos) {
+        if(pos != impl::SPLIT_DONE) {
+            find_line(pos);
+        }
+    }
+
+    LinesIterator<Char>& operator++() {
+        find_line(end == size ? size : end + 1);
+        return *this;
+    }
+
+    bool operator==(const LinesIterator<Char>& other) const { return pos == other.pos; }
+    bool operator!=(const LinesIterator<Char>& other) const { return pos != other.pos; }
+    Element operator*() {
+        size_t line_end = end;
+        if(line_end > pos && end < size && data[line_end - 1] == '\r') {
+            line_end--;
+        }
+        return Element(data + pos, line_end - pos, is_null_terminated && line_end == size);
+    }
+};
+
+template<typename Char>
+class LinesIterable: public Iterable<LinesIterable<Char>> {
+    const Char* data;
+    size_t size;
+    bool is_null_terminated;
+public:
+    using Iterator = LinesIterator<Char>;
+
+    LinesIterable(const Char* data, size_t size, bool is_null_terminated) : data(data), size(size), is_null_terminated(is_null_terminated) {}
+    Iterator begin() const { return Iterator(data, size, is_null_terminated, 0); }
+    Iterator end() const { return Iterator(data, size, is_null_terminated, impl::SPLIT_DONE); }
+};
+
+};
@@ -0,0 +1,142 @@
+#include <assert.h>
+#include <math.h>
+#include <new>
+
+#include "trace.h"
+#include "fmt.h"
+
+ZW_DEFINE_CTX_VAR(zw::Tracer*, tracer, nullptr);
+
+namespace zw {
+
+// Ids start at 1, so that an empty cache never matches
+static std::atomic<uint64_t> num_tracers {0};
+
+thread_local impl::TraceThreadCache impl::trace_thread_cache {0, nullptr};
+
+// Chunks and buffers are allocated with the allocator's methods rather than zw_alloc, which may be traced
+static impl::TraceChunk* make_chunk(Allocator* allocator) {
+    void* address = allocator->alloc(sizeof(impl::TraceChunk), alignof(impl::TraceChunk));
+    assert(address && "allocator out of memory");
+    return new(address) impl::TraceChunk();
+}
+
+void impl::TraceThreadBuffer::add_chunk() {
+    TraceChunk* chunk = make_chunk(allocator);
+    last_chunk->next.store(chunk, std::memory_order_release);
+    last_chunk = chunk;
+}
+
+Tracer::Tracer(Allocator* allocator) : _allocator(allocator), _first_buffer(nullptr), _num_threads(0) {
+    _id = ++num_tracers;
+    _start_timestamp = impl::trace_timestamp();
+    _start_time = std::chrono::steady_clock::now();
+}
+
+Tracer::~Tracer() {
+    impl::TraceThreadBuffer* buffer = _first_buffer;
+    while(buffer) {
+        impl::TraceChunk* chunk = buffer->first_chunk;
+        while(chunk) {
+            impl::TraceChunk* next = chunk->next.load(std::memory_order_relaxed);
+            chunk->~TraceChunk();
+            _allocator->free(chunk);
+            chunk = next;
+        }
+        impl::TraceThreadBuffer* next = buffer->next;
+        _allocator->free(buffer);
+        buffer = next;
+    }
+}
+
+impl::TraceThreadBuffer* Tracer::register_thread() {
+    std::lock_guard<std::mutex> lock(_lock);
+    std::thread::id thread = std::this_thread::get_id();
+    // The thread may have recorded into this tracer before, and into another one since
+    impl::TraceThreadBuffer* buffer = _first_buffer;
+    while(buffer && buffer->thread != thread) {
+        buffer = buffer->next;
+    }
+    if(!buffer) {
+        buffer = (impl::TraceThreadBuffer*)_allocator->alloc(sizeof(impl::TraceThreadBuffer), alignof(impl::TraceThreadBuffer));
+        assert(buffer && "allocator out of memory");
+        buffer->allocator = _allocator;
+        buffer->thread = thread;
+        buffer->thread_index = ++_num_threads;
+        buffer->first_chunk = make_chunk(_allocator);
+        buffer->last_chunk = buffer->first_chunk;
+        buffer->next = _first_buffer;
+        _first_buffer = buffer;
+    }
+    impl::trace_thread_cache = {_id, buffer};
+    return buffer;
+}
+
+// Event names come from user code, so they're escaped
+static void print_json_string(const char* string) {
+    zw_print("\"");
+    const char* run = string;
+    for(const char* c = string; *c; c++) {
+        if(*c == '"' || *c == '\\' || (unsigned char)*c < 0x20) {
+            zw_print("{}", StringSlice(run, c - run));
+            if(*c == '"' || *c == '\\') {
+                zw_print("\\{}", StringSlice(c, 1));
+            } else {
+                const char* digits = "0123456789abcdef";
+                zw_print("\\u00{}{}", StringSlice(digits + (*c >> 4), 1), StringSlice(digits + (*c & 0xF), 1));
+            }
+            run = c + 1;
+        }
+    }
+    zw_print("{}\"", StringSlice(run));
+}
+
+void Tracer::print_chrome_trace() const {
+    // Printing may allocate, which must not be traced into the events being printed
+    zw_set_ctx(tracer, nullptr);
+
+    uint64_t elapsed_timestamp = impl::trace_timestamp() - _start_timestamp;
+    double elapsed_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - _start_time).count();
+    double timestamps_per_us = elapsed_us > 0 ? (double)elapsed_timestamp / elapsed_us : 1;
+    // To the nanosecond
+    auto to_us = [&](int64_t timestamp_delta) {
+        return round((double)timestamp_delta / timestamps_per_us * 1000.0) / 1000.0;
+    };
+
+    std::lock_guard<std::mutex> lock(_lock);
+    zw_print("{{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+    bool is_first = true;
+    for(impl::TraceThreadBuffer* buffer = _first_buffer; buffer; buffer = buffer->next) {
+        zw_print("{}\n{{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": {}, \"args\": {{\"name\": \"thread {}\"}}}}", is_first ? "" : ",", buffer->thread_index, buffer->thread_index);
+        is_first = false;
+        for(impl::TraceChunk* chunk = buffer->first_chunk; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+            uint32_t size = chunk->size.load(std::memory_order_acquire);
+            for(uint32_t i = 0; i < size; i++) {
+                const impl::TraceEvent& event = chunk->events[i];
+                zw_print(",\n{{\"name\": ");
+                print_json_string(event.name);
+                // Times are relative to when the tracer was created
+                double begin = to_us((int64_t)(event.begin - _start_timestamp));
+                if(event.kind == impl::TraceEventKind::SCOPE) {
+                    zw_print(", \"ph\": \"X\", \"pid\": 1, \"tid\": {}, \"ts\": {}, \"dur\": {}}}", buffer->thread_index, begin, to_us((int64_t)(event.end - event.begin)));
+                } else {
+                    zw_print(", \"ph\": \"i\", \"s\": \"t\", \"pid\": 1, \"tid\": {}, \"ts\": {}, \"args\": {{\"value\": {}}}}}", buffer->thread_index, begin, event.value);
+                }
+            }
+        }
+    }
+    zw_println("\n]}}");
+}
+
+uint64_t Tracer::num_events() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    uint64_t num_events = 0;
+    for(impl::TraceThreadBuffer* buffer = _first_buffer; buffer; buffer = buffer->next) {
+        for(impl::TraceChunk* chunk = buffer->first_chunk; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+            num_events += chunk->size.load(std::memory_order_acquire);
+        }
+    }
+    return num_events;
+}
+
+};
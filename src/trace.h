@@ -0,0 +1,180 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "alloc.h"
+#include "context.h"
+#include "defer.h"
+#include "macros.h"
+
+// Scoped tracing. zw_trace_scope("name") records when the enclosing scope begins and ends into the context
+// tracer, if there is one, and Tracer::print_chrome_trace() writes everything recorded as Chrome trace event
+// JSON, which chrome://tracing and https://ui.perfetto.dev can open.
+//
+// Each thread records into a buffer of its own, so recording never takes a lock or touches memory another
+// thread writes to: only the first event a thread records into a given tracer has to find or create its
+// buffer. Timestamps are read from the TSC on x86, and from the steady clock elsewhere.
+//
+// With ZW_TRACE_ALLOCATIONS defined, zw_alloc, zw_realloc and zw_free record instant events as well.
+
+namespace zw { class Tracer; };
+
+ZW_DECLARE_CTX_VAR(zw::Tracer*, tracer);
+
+namespace zw {
+
+namespace impl {
+    inline uint64_t trace_timestamp() {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    enum class TraceEventKind: uint32_t {
+        SCOPE,
+        INSTANT,
+    };
+
+    struct TraceEvent {
+        // Not copied, so it must outlive the tracer
+        const char* name;
+        uint64_t begin;
+        union {
+            // Scopes
+            uint64_t end;
+            // Instant events
+            uint64_t value;
+        };
+        TraceEventKind kind;
+    };
+
+    constexpr uint32_t TRACE_CHUNK_CAP = 4096;
+
+    struct TraceChunk {
+        // Events below size are published, and no longer change
+        std::atomic<uint32_t> size {0};
+        std::atomic<TraceChunk*> next {nullptr};
+        TraceEvent events[TRACE_CHUNK_CAP];
+    };
+
+    // The events one thread recorded into one tracer. Only that thread writes to it.
+    struct TraceThreadBuffer {
+        Allocator* allocator;
+        std::thread::id thread;
+        uint32_t thread_index;
+        TraceChunk* first_chunk;
+        TraceChunk* last_chunk;
+        TraceThreadBuffer* next;
+
+        void add_chunk();
+
+        void push(TraceEventKind kind, const char* name, uint64_t begin, uint64_t end_or_value) {
+            uint32_t size = last_chunk->size.load(std::memory_order_relaxed);
+            if(size == TRACE_CHUNK_CAP) {
+                add_chunk();
+                size = 0;
+            }
+            TraceEvent* event = &last_chunk->events[size];
+            event->name = name;
+            event->begin = begin;
+            event->end = end_or_value;
+            event->kind = kind;
+            last_chunk->size.store(size + 1, std::memory_order_release);
+        }
+    };
+
+    // The buffer the thread last recorded into, and the id of the tracer it belongs to
+    struct TraceThreadCache {
+        uint64_t tracer_id;
+        TraceThreadBuffer* buffer;
+    };
+    extern thread_local TraceThreadCache trace_thread_cache;
+};
+
+/// Collects trace events from any number of threads. Install one with zw_set_ctx(tracer, ...) on each thread
+/// that should be traced. It must outlive every scope traced into it.
+class Tracer {
+    Allocator* _allocator;
+    uint64_t _id;
+    // Timestamps are converted to microseconds by comparing how far they and the steady clock have advanced
+    // since the tracer was created
+    uint64_t _start_timestamp;
+    std::chrono::steady_clock::time_point _start_time;
+    mutable std::mutex _lock;
+    impl::TraceThreadBuffer* _first_buffer;
+    uint32_t _num_threads;
+
+    impl::TraceThreadBuffer* register_thread();
+
+public:
+    explicit Tracer(Allocator* allocator = zw_get_ctx(allocator));
+    Tracer(const Tracer& other) = delete;
+    Tracer(Tracer&& other) = delete;
+    ~Tracer();
+
+    /// The calling thread's buffer.
+    impl::TraceThreadBuffer* thread_buffer() {
+        impl::TraceThreadCache& cache = impl::trace_thread_cache;
+        if(cache.tracer_id == _id) {
+            return cache.buffer;
+        }
+        return register_thread();
+    }
+
+    /// Prints everything recorded so far through the context printer as Chrome trace event JSON, with one
+    /// event per line. Put a BufferedPrinter in front of the destination if there are many events. Other
+    /// threads may keep recording while this runs; whatever they record after it starts may be left out.
+    void print_chrome_trace() const;
+    /// Number of events recorded so far.
+    uint64_t num_events() const;
+};
+
+namespace impl {
+    struct TraceScope {
+        TraceThreadBuffer* buffer;
+        const char* name;
+        uint64_t begin;
+    };
+
+    inline TraceScope trace_begin(const char* name) {
+        Tracer* tracer = zw_get_ctx(tracer);
+        if(!tracer) {
+            return {nullptr, name, 0};
+        }
+        return {tracer->thread_buffer(), name, trace_timestamp()};
+    }
+
+    inline void trace_end(const TraceScope& scope) {
+        if(scope.buffer) {
+            scope.buffer->push(TraceEventKind::SCOPE, scope.name, scope.begin, trace_timestamp());
+        }
+    }
+};
+
+};
+
+/// Records the rest of the enclosing scope as a trace event called name, which must outlive the tracer, e.g.
+/// a string literal. Does nothing if there is no context tracer.
+#define zw_trace_scope(name, ...) \
+    auto ZW_CONCAT(__trace_scope__, __LINE__ ## __VA_ARGS__) = ::zw::impl::trace_begin(name); \
+    zw_defer(::zw::impl::trace_end(ZW_CONCAT(__trace_scope__, __LINE__ ## __VA_ARGS__)), __VA_ARGS__)
+
+/// Records a point in time as a trace event called name, which must outlive the tracer, with a value that is
+/// shown as its argument. Does nothing if there is no context tracer.
+inline void zw_trace_instant(const char* name, uint64_t value = 0) {
+    zw::Tracer* tracer = zw_get_ctx(tracer);
+    if(tracer) {
+        tracer->thread_buffer()->push(zw::impl::TraceEventKind::INSTANT, name, zw::impl::trace_timestamp(), value);
+    }
+}
@@ -0,0 +1,284 @@
+#include <string.h>
+#include <bit>
+
+#include "macros.h"
+#include "unicode.h"
+
+#ifdef ZW_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace zw {
+
+constexpr uint32_t INVALID = 0xFFFFFFFF;
+
+// Decodes the sequence at the start of s, setting *length to the number of bytes it takes up.
+// Returns INVALID if the sequence is ill-formed, with *length covering its longest well-formed prefix, or
+// the first byte if there is none. This is the replacement rule the Unicode standard recommends.
+static uint32_t decode_utf8(const uint8_t* s, size_t size, size_t* length) {
+    *length = 1;
+    uint8_t lead = s[0];
+    if(lead < 0x80) return lead;
+
+    size_t sequence_length;
+    uint32_t code_point;
+    // The allowed range of the second byte excludes overlong encodings, surrogates and values past U+10FFFF
+    uint8_t second_min = 0x80;
+    uint8_t second_max = 0xBF;
+    if(lead >= 0xC2 && lead <= 0xDF) {
+        sequence_length = 2;
+        code_point = lead & 0x1F;
+    } else if(lead >= 0xE0 && lead <= 0xEF) {
+        sequence_length = 3;
+        code_point = lead & 0x0F;
+        if(lead == 0xE0) second_min = 0xA0;
+        if(lead == 0xED) second_max = 0x9F;
+    } else if(lead >= 0xF0 && lead <= 0xF4) {
+        sequence_length = 4;
+        code_point = lead & 0x07;
+        if(lead == 0xF0) second_min = 0x90;
+        if(lead == 0xF4) second_max = 0x8F;
+    } else {
+        return INVALID;
+    }
+
+    for(size_t i = 1; i < sequence_length; i++) {
+        uint8_t min = i == 1 ? second_min : 0x80;
+        uint8_t max = i == 1 ? second_max : 0xBF;
+        if(i == size || s[i] < min || s[i] > max) {
+            // The bytes so far are skipped as a single unit
+            *length = i;
+            return INVALID;
+        }
+        code_point = (code_point << 6) | (s[i] & 0x3F);
+    }
+    *length = sequence_length;
+    return code_point;
+}
+
+// Like decode_utf8(), for the wide encoding. Unpaired surrogates are invalid.
+static uint32_t decode_wide(const wchar_t* s, size_t size, size_t* length) {
+    *length = 1;
+    uint32_t unit = (uint32_t)s[0];
+    if constexpr(sizeof(wchar_t) == 2) {
+        if(unit >= 0xD800 && unit <= 0xDBFF && size > 1) {
+            uint32_t low = (uint32_t)s[1];
+            if(low >= 0xDC00 && low <= 0xDFFF) {
+                *length = 2;
+                return 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+            }
+        }
+    } else {
+        if(unit > 0x10FFFF) return INVALID;
+    }
+    if(unit >= 0xD800 && unit <= 0xDFFF) return INVALID;
+    return unit;
+}
+
+static size_t wide_length_of(uint32_t code_point) {
+    return sizeof(wchar_t) == 2 && code_point >= 0x10000 ? 2 : 1;
+}
+
+static size_t utf8_length_of(uint32_t code_point) {
+    if(code_point < 0x80) return 1;
+    if(code_point < 0x800) return 2;
+    if(code_point < 0x10000) return 3;
+    return 4;
+}
+
+static size_t encode_wide(uint32_t code_point, wchar_t* out) {
+    if(sizeof(wchar_t) == 2 && code_point >= 0x10000) {
+        code_point -= 0x10000;
+        out[0] = (wchar_t)(0xD800 + (code_point >> 10));
+        out[1] = (wchar_t)(0xDC00 + (code_point & 0x3FF));
+        return 2;
+    }
+    out[0] = (wchar_t)code_point;
+    return 1;
+}
+
+static size_t encode_utf8(uint32_t code_point, char* out) {
+    if(code_point < 0x80) {
+        out[0] = (char)code_point;
+        return 1;
+    }
+    if(code_point < 0x800) {
+        out[0] = (char)(0xC0 | (code_point >> 6));
+        out[1] = (char)(0x80 | (code_point & 0x3F));
+        return 2;
+    }
+    if(code_point < 0x10000) {
+        out[0] = (char)(0xE0 | (code_point >> 12));
+        out[1] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code_point & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (code_point >> 18));
+    out[1] = (char)(0x80 | ((code_point >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code_point & 0x3F));
+    return 4;
+}
+
+// Number of leading ASCII bytes in the 16 bytes at s, or 16 if they all are.
+static size_t ascii_prefix_16(const uint8_t* s) {
+#ifdef ZW_SSE2
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)s));
+    return mask ? std::countr_zero(mask) : 16;
+#else
+    uint64_t words[2];
+    memcpy(words, s, 16);
+    uint64_t high_bits = words[0] & 0x8080808080808080ull;
+    if(high_bits) return std::countr_zero(high_bits) / 8;
+    high_bits = words[1] & 0x8080808080808080ull;
+    if(high_bits) return 8 + std::countr_zero(high_bits) / 8;
+    return 16;
+#endif
+}
+
+// Widens 16 ASCII bytes.
+static void widen_ascii_16(const uint8_t* s, wchar_t* out) {
+#ifdef ZW_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i block = _mm_loadu_si128((const __m128i*)s);
+    __m128i low = _mm_unpacklo_epi8(block, zero);
+    __m128i high = _mm_unpackhi_epi8(block, zero);
+    if constexpr(sizeof(wchar_t) == 2) {
+        _mm_storeu_si128((__m128i*)out, low);
+        _mm_storeu_si128((__m128i*)(out + 8), high);
+    } else {
+        _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi16(low, zero));
+        _mm_storeu_si128((__m128i*)(out + 4), _mm_unpackhi_epi16(low, zero));
+        _mm_storeu_si128((__m128i*)(out + 8), _mm_unpacklo_epi16(high, zero));
+        _mm_storeu_si128((__m128i*)(out + 12), _mm_unpackhi_epi16(high, zero));
+    }
+#else
+    for(size_t i = 0; i < 16; i++) {
+        out[i] = (wchar_t)s[i];
+    }
+#endif
+}
+
+// Narrows 16 wide code units if they are all ASCII. Returns false, without writing anything, otherwise.
+static bool narrow_ascii_16(const wchar_t* s, char* out) {
+#ifdef ZW_SSE2
+    if constexpr(sizeof(wchar_t) == 2) {
+        __m128i a = _mm_loadu_si128((const __m128i*)s);
+        __m128i b = _mm_loadu_si128((const __m128i*)(s + 8));
+        __m128i non_ascii = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16((short)0xFF80));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi16(non_ascii, _mm_setzero_si128())) != 0xFFFF) return false;
+        _mm_storeu_si128((__m128i*)out, _mm_packus_epi16(a, b));
+        return true;
+    }
+#endif
+    uint32_t all = 0;
+    for(size_t i = 0; i < 16; i++) {
+        all |= (uint32_t)s[i];
+    }
+    if(all >= 0x80) return false;
+    for(size_t i = 0; i < 16; i++) {
+        out[i] = (char)s[i];
+    }
+    return true;
+}
+
+bool is_valid_utf8(const char* utf8, size_t size) {
+    const uint8_t* s = (const uint8_t*)utf8;
+    size_t i = 0;
+    while(i < size) {
+        if(i + 16 <= size) {
+            size_t ascii = ascii_prefix_16(s + i);
+            i += ascii;
+            if(ascii == 16) continue;
+        } else if(s[i] < 0x80) {
+            i++;
+            continue;
+        }
+        size_t length;
+        if(decode_utf8(s + i, size - i, &length) == INVALID) return false;
+        i += length;
+    }
+    return true;
+}
+
+size_t utf8_to_wide_length(const char* utf8, size_t size) {
+    const uint8_t* s = (const uint8_t*)utf8;
+    size_t result = 0;
+    size_t i = 0;
+    while(i < size) {
+        if(i + 16 <= size) {
+            size_t ascii = ascii_prefix_16(s + i);
+            i += ascii;
+            result += ascii;
+            if(ascii == 16) continue;
+        } else if(s[i] < 0x80) {
+            i++;
+            result++;
+            continue;
+        }
+        size_t length;
+        uint32_t code_point = decode_utf8(s + i, size - i, &length);
+        result += code_point == INVALID ? 1 : wide_length_of(code_point);
+        i += length;
+    }
+    return result;
+}
+
+size_t utf8_to_wide(const char* utf8, size_t size, wchar_t* out) {
+    const uint8_t* s = (const uint8_t*)utf8;
+    wchar_t* out_begin = out;
+    size_t i = 0;
+    while(i < size) {
+        if(i + 16 <= size) {
+            size_t ascii = ascii_prefix_16(s + i);
+            if(ascii == 16) {
+                widen_ascii_16(s + i, out);
+                i += 16;
+                out += 16;
+                continue;
+            }
+            for(size_t j = 0; j < ascii; j++) {
+                *out++ = (wchar_t)s[i++];
+            }
+        } else if(s[i] < 0x80) {
+            *out++ = (wchar_t)s[i++];
+            continue;
+        }
+        size_t length;
+        uint32_t code_point = decode_utf8(s + i, size - i, &length);
+        out += encode_wide(code_point == INVALID ? REPLACEMENT_CHARACTER : code_point, out);
+        i += length;
+    }
+    return out - out_begin;
+}
+
+size_t wide_to_utf8_length(const wchar_t* wide, size_t size) {
+    size_t result = 0;
+    size_t i = 0;
+    while(i < size) {
+        size_t length;
+        uint32_t code_point = decode_wide(wide + i, size - i, &length);
+        result += utf8_length_of(code_point == INVALID ? REPLACEMENT_CHARACTER : code_point);
+        i += length;
+    }
+    return result;
+}
+
+size_t wide_to_utf8(const wchar_t* wide, size_t size, char* out) {
+    char* out_begin = out;
+    size_t i = 0;
+    while(i < size) {
+        if(i + 16 <= size && narrow_ascii_16(wide + i, out)) {
+            i += 16;
+            out += 16;
+            continue;
+        }
+        size_t length;
+        uint32_t code_point = decode_wide(wide + i, size - i, &length);
+        out += encode_utf8(code_point == INVALID ? REPLACEMENT_CHARACTER : code_point, out);
+        i += length;
+    }
+    return out - out_begin;
+}
+
+};
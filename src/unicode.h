@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Conversion between UTF-8 and the platform's wide encoding: UTF-16 where wchar_t is 2 bytes (Windows) and
+// UTF-32 where it is 4. None of these need null-terminated input.
+//
+// Ill-formed input never fails: each maximal ill-formed subsequence, or unpaired surrogate, becomes U+FFFD.
+// The *_length functions apply the same rule, so they give the exact size of the output, which lets callers
+// allocate the destination once up front.
+
+namespace zw {
+
+constexpr uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+bool is_valid_utf8(const char* utf8, size_t size);
+
+/// Number of wchar_t code units utf8_to_wide() writes for this input.
+size_t utf8_to_wide_length(const char* utf8, size_t size);
+/// Transcodes size bytes of UTF-8 into out, which must have room for utf8_to_wide_length() code units.
+/// Returns the number of code units written.
+size_t utf8_to_wide(const char* utf8, size_t size, wchar_t* out);
+
+/// Number of bytes wide_to_utf8() writes for this input.
+size_t wide_to_utf8_length(const wchar_t* wide, size_t size);
+/// Transcodes size wide code units into out, which must have room for wide_to_utf8_length() bytes.
+/// Returns the number of bytes written.
+size_t wide_to_utf8(const wchar_t* wide, size_t size, char* out);
+
+};